@@ -45,6 +45,36 @@ Animation::Animation(const char* folderPath, const char* repeatedName,
     //here the vector should be filled with the textures.
 }
 
+Animation::Animation(const TextureAtlas& atlas, const char* folderPath, const char* repeatedName,
+                     int frameCount, float frameDuration, float frameDelay) :
+    repeatedName_(repeatedName), animationFrames_(), animationPath_(folderPath), isRunning_(false),
+    isLooping_(false), isDone_(false), frameDuration_(frameDuration),
+    frameDelay_(frameDelay), frameCount_(frameCount)
+{
+    /* frames must have been queued with atlas.addAnimation and built already */
+    for (int i = 0; i < frameCount; ++i)
+    {
+        AtlasRegion region;
+        if (!atlas.find(repeatedName_ + std::to_string(i), region))
+            std::cout << "ERROR::ANIMATION::FRAME_NOT_IN_ATLAS " << repeatedName_ << i << std::endl;
+        atlasFrames_.push_back(region);
+    }
+}
+
+Animation::Animation(TextureCache& cache, const char* folderPath, const char* repeatedName,
+                     int frameCount, float frameDuration, float frameDelay) :
+    repeatedName_(repeatedName), animationFrames_(), animationPath_(folderPath), isRunning_(false),
+    isLooping_(false), isDone_(false), frameDuration_(frameDuration),
+    frameDelay_(frameDelay), frameCount_(frameCount), cache_(&cache)
+{
+    /* requested in order, so frame 0 is decoded first and shown while the rest load */
+    for (int i = 0; i < frameCount; ++i)
+    {
+        std::string path = animationPath_ + "/" + repeatedName_ + std::to_string(i) + ".png";
+        streamedFrames_.push_back(cache.acquire(path));
+    }
+}
+
 //advances the frames.
 void Animation::animationUpdate(float dt)
 {
@@ -87,6 +117,14 @@ void Animation::animationPlay()
 void Animation::advanceFrame()
 {
     //this function is only called when enough time has elapsed. 
+    if (!atlasFrames_.empty() || !streamedFrames_.empty())
+    {
+        //atlas and streamed frames are already resolved, only the index changes
+        shownFrame_ = (unsigned int)loops_ % (atlasFrames_.empty() ? streamedFrames_.size() : atlasFrames_.size());
+        frameDelay_ = frameDuration_;
+        return;
+    }
+
     std::string textureName = repeatedName_ + std::to_string(loops_);
     animationFrames_[0].setName(textureName);
     frameDelay_ = frameDuration_;
@@ -145,6 +183,57 @@ std::string Animation::getRepeatingName() const
     return repeatedName_;
 }
 
+bool Animation::usesAtlas() const
+{
+    return !atlasFrames_.empty();
+}
+
+const AtlasRegion& Animation::getCurrentRegion() const
+{
+    return atlasFrames_[shownFrame_];
+}
+
+const std::vector<AtlasRegion>& Animation::getAtlasFrames() const
+{
+    return atlasFrames_;
+}
+
+bool Animation::usesStreaming() const
+{
+    return cache_ != nullptr;
+}
+
+//frames that are not resident fall back to frame 0, then to the placeholder.
+//using the frame is what keeps it from being evicted, so call this once per draw.
+//only the shown frame counts as a hit or miss, the fallback is touched so it stays loaded
+unsigned int Animation::getCurrentTexture() const
+{
+    if (!usesStreaming())
+    {
+        //atlas frames know their page, Texture frames bind themselves and have no name here
+        return atlasFrames_.empty() ? 0 : atlasFrames_[shownFrame_].texture;
+    }
+
+    unsigned int texture = cache_->use(streamedFrames_[shownFrame_]);
+    if (shownFrame_ == 0 || cache_->isResident(streamedFrames_[shownFrame_]))
+        return texture;
+
+    return cache_->touch(streamedFrames_[0]);
+}
+
+bool Animation::getIsResident() const
+{
+    if (!usesStreaming())
+        return true; //atlas and Texture frames are loaded when the animation is made
+
+    for (const TextureCache::Handle& frame : streamedFrames_)
+    {
+        if (!cache_->isResident(frame))
+            return false;
+    }
+    return true;
+}
+
 
 //settors
 
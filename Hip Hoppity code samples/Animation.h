@@ -11,6 +11,8 @@
 #include <vector> // for storing all animation frames (vector of textures)
 #include "Texture.h"
 #include "Shader.h"
+#include "TextureAtlas.h"
+#include "TextureCache.h"
 
 class Animation 
 {
@@ -22,6 +24,12 @@ public:
     Animation(const char* folderPath, const char* repeatedName,
         int frameCount, float frameDuration, float frameDelay,
         Shader& shader);
+    //frames come from an already built atlas, advancing only switches uv rects
+    Animation(const TextureAtlas& atlas, const char* folderPath, const char* repeatedName,
+        int frameCount, float frameDuration, float frameDelay);
+    //frames are decoded in the background through the cache, usable right away with a placeholder
+    Animation(TextureCache& cache, const char* folderPath, const char* repeatedName,
+        int frameCount, float frameDuration, float frameDelay);
 
     void animationUpdate(float dt); //advances the frames.
     void animationPlay();
@@ -39,6 +47,12 @@ public:
     const std::vector<Texture>& getAnimationFrames() const;
     std::string getRepeatingName() const;
     int getHoldFrame() const { return holdFrame_; }
+    bool usesAtlas() const;
+    const AtlasRegion& getCurrentRegion() const; //atlas page and uv rect for the shown frame
+    const std::vector<AtlasRegion>& getAtlasFrames() const;
+    bool usesStreaming() const;
+    unsigned int getCurrentTexture() const; //shown frame, else frame 0, else the placeholder. Atlas page without streaming, 0 for Texture frames
+    bool getIsResident() const; //whether every streamed frame is resident right now, always true without streaming
 
     //settors
     void setFrameCount(unsigned int frameCount);
@@ -63,5 +77,9 @@ private:
     std::string repeatedName_;              // the repeating name for animations
     int loops_ = 0;                         // helper for seeing when animations 
     int holdFrame_ = 0;                     // whether to hold a frame in animation
+    std::vector<AtlasRegion> atlasFrames_;  // page and uv rect per frame, empty when not using an atlas
+    TextureCache* cache_ = nullptr;         // loads and evicts streamedFrames_, null when not streaming
+    std::vector<TextureCache::Handle> streamedFrames_; // one handle per frame
+    unsigned int shownFrame_ = 0;           // index of the frame being shown for atlas or streamed frames
 
 };
\ No newline at end of file
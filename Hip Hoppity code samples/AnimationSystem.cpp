@@ -0,0 +1,232 @@
+/*
+ * file: AnimationSystem.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the AnimationSystem class,
+ *        this advances all animations in one pass over flat arrays.
+ */
+
+#include "AnimationSystem.h"
+#include <iostream>
+
+/* Use Notes:
+
+Frames come from the atlas, so the Animation must have been made with the
+TextureAtlas constructor before it is added.
+
+Animation::animationUpdate treats "Run_" as the one animation that wraps,
+here that is the looping flag given to add(). When a non looping animation
+shows its last frame its id is put in getCompleted() for that tick, which
+replaces polling swapToRun.
+
+Frame regions of removed animations are not reclaimed, levels are expected
+to add their animations once at load.
+
+A removed animation's slot is reused with a new generation, so its old id
+never refers to the animation that took the slot. Only remove() and
+isAlive() check ids, the per animation calls expect a live one.
+
+*/
+
+AnimationSystem::AnimationSystem(unsigned int expectedAnimations)
+{
+    timers_.reserve(expectedAnimations);
+    durations_.reserve(expectedAnimations);
+    frames_.reserve(expectedAnimations);
+    frameCounts_.reserve(expectedAnimations);
+    holdFrames_.reserve(expectedAnimations);
+    firstFrame_.reserve(expectedAnimations);
+    current_.reserve(expectedAnimations);
+    running_.reserve(expectedAnimations);
+    looping_.reserve(expectedAnimations);
+    ids_.reserve(expectedAnimations);
+    completed_.reserve(expectedAnimations);
+}
+
+AnimationSystem::AnimationId AnimationSystem::add(const Animation& animation, bool looping)
+{
+    return add(animation.getAtlasFrames(), animation.getFrameDuration(), animation.getFrameDelay(),
+        looping, animation.getHoldFrame());
+}
+
+AnimationSystem::AnimationId AnimationSystem::add(const std::vector<AtlasRegion>& frames,
+    float frameDuration, float frameDelay, bool looping, int holdFrame)
+{
+    if (frames.empty())
+        return INVALID_ANIMATION;
+
+    unsigned int slot;
+    if (!freeSlots_.empty())
+    {
+        slot = freeSlots_.back();
+        freeSlots_.pop_back();
+    }
+    else
+    {
+        //the last slot is left out, its id could come out as INVALID_ANIMATION
+        if (sparse_.size() >= ID_INDEX_MASK)
+        {
+            std::cout << "ERROR::ANIMATION_SYSTEM::FULL " << sparse_.size() << " animations" << std::endl;
+            return INVALID_ANIMATION;
+        }
+
+        slot = (unsigned int)sparse_.size();
+        sparse_.push_back(NONE);
+        generations_.push_back(1);
+    }
+
+    AnimationId id = (generations_[slot] << ID_INDEX_BITS) | slot;
+    unsigned int first = addFrames(frames);
+    sparse_[slot] = (unsigned int)ids_.size();
+
+    timers_.push_back(frameDelay);
+    durations_.push_back(frameDuration);
+    frames_.push_back(0);
+    frameCounts_.push_back((int)frames.size());
+    holdFrames_.push_back(holdFrame);
+    firstFrame_.push_back(first);
+    current_.push_back(first);
+    running_.push_back(0);
+    looping_.push_back(looping ? 1 : 0);
+    ids_.push_back(id);
+
+    //completed can never be longer than the animation count
+    if (completed_.capacity() < ids_.size())
+        completed_.reserve(ids_.capacity());
+
+    return id;
+}
+
+//swaps the last animation into the hole so the arrays stay dense
+void AnimationSystem::remove(AnimationId id)
+{
+    if (!isAlive(id))
+        return;
+
+    unsigned int slot = id & ID_INDEX_MASK;
+    unsigned int index = sparse_[slot];
+    unsigned int last = (unsigned int)ids_.size() - 1;
+
+    timers_[index] = timers_[last];
+    durations_[index] = durations_[last];
+    frames_[index] = frames_[last];
+    frameCounts_[index] = frameCounts_[last];
+    holdFrames_[index] = holdFrames_[last];
+    firstFrame_[index] = firstFrame_[last];
+    current_[index] = current_[last];
+    running_[index] = running_[last];
+    looping_[index] = looping_[last];
+    ids_[index] = ids_[last];
+    sparse_[ids_[index] & ID_INDEX_MASK] = index;
+
+    timers_.pop_back();
+    durations_.pop_back();
+    frames_.pop_back();
+    frameCounts_.pop_back();
+    holdFrames_.pop_back();
+    firstFrame_.pop_back();
+    current_.pop_back();
+    running_.pop_back();
+    looping_.pop_back();
+    ids_.pop_back();
+
+    sparse_[slot] = NONE;
+    generations_[slot] = generations_[slot] == MAX_GENERATION ? 1 : generations_[slot] + 1;
+    freeSlots_.push_back(slot);
+}
+
+//same stepping as Animation::animationUpdate, for every animation at once
+void AnimationSystem::update(float dt)
+{
+    completed_.clear();
+    const size_t count = ids_.size();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!running_[i])
+            continue;
+
+        timers_[i] -= dt;
+        if (timers_[i] > 0)
+            continue;
+
+        int frame = frames_[i];
+        if (holdFrames_[i] == 0 || frame != holdFrames_[i])
+        {
+            current_[i] = firstFrame_[i] + (unsigned int)frame;
+            timers_[i] = durations_[i];
+            frame += 1;
+        }
+
+        if (frame >= frameCounts_[i])
+        {
+            if (!looping_[i])
+                completed_.push_back(ids_[i]);
+            frame = 0;
+        }
+
+        frames_[i] = frame;
+    }
+}
+
+const std::vector<AnimationSystem::AnimationId>& AnimationSystem::getCompleted() const
+{
+    return completed_;
+}
+
+void AnimationSystem::play(AnimationId id)
+{
+    running_[indexOf(id)] = 1;
+}
+
+void AnimationSystem::stop(AnimationId id)
+{
+    running_[indexOf(id)] = 0;
+}
+
+void AnimationSystem::setHoldFrame(AnimationId id, int frame)
+{
+    holdFrames_[indexOf(id)] = frame;
+}
+
+void AnimationSystem::setCurrentFrame(AnimationId id, int frame)
+{
+    unsigned int index = indexOf(id);
+    frames_[index] = frame % frameCounts_[index];
+    current_[index] = firstFrame_[index] + (unsigned int)frames_[index];
+}
+
+//gettors
+
+bool AnimationSystem::isAlive(AnimationId id) const
+{
+    unsigned int slot = id & ID_INDEX_MASK;
+    return slot < sparse_.size() && sparse_[slot] != NONE && generations_[slot] == id >> ID_INDEX_BITS;
+}
+
+const AtlasRegion& AnimationSystem::getCurrentRegion(AnimationId id) const
+{
+    return regions_[current_[indexOf(id)]];
+}
+
+int AnimationSystem::getCurrentFrame(AnimationId id) const
+{
+    return frames_[indexOf(id)];
+}
+
+bool AnimationSystem::getIsRunning(AnimationId id) const
+{
+    return running_[indexOf(id)] != 0;
+}
+
+unsigned int AnimationSystem::getCount() const
+{
+    return (unsigned int)ids_.size();
+}
+
+//copies the regions in once, update only ever works with indices into them
+unsigned int AnimationSystem::addFrames(const std::vector<AtlasRegion>& frames)
+{
+    unsigned int first = (unsigned int)regions_.size();
+    regions_.insert(regions_.end(), frames.begin(), frames.end());
+    return first;
+}
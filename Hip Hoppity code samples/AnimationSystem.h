@@ -0,0 +1,77 @@
+/*
+ * file: AnimationSystem.h
+ * author: Mark Kouris
+ * brief: the interface of the AnimationSystem class.
+ *      Holds the state of every animation in flat arrays and advances all of
+ *      them in one pass per tick. Frames are pre-resolved atlas regions, so a
+ *      tick does no string work and no allocations, and animations that reach
+ *      their last frame are reported as completion events.
+ *
+ */
+#pragma once
+#include <vector>
+#include "Animation.h"
+#include "TextureAtlas.h"
+
+class AnimationSystem
+{
+public:
+    typedef unsigned int AnimationId;
+    static const AnimationId INVALID_ANIMATION = 0xFFFFFFFF;
+
+    AnimationSystem(unsigned int expectedAnimations = 1024);
+
+    //adds an animation built from an atlas, looping ones never complete
+    AnimationId add(const Animation& animation, bool looping);
+    AnimationId add(const std::vector<AtlasRegion>& frames, float frameDuration,
+        float frameDelay, bool looping, int holdFrame = 0);
+    //stale ids, INVALID_ANIMATION and removing twice are ignored
+    void remove(AnimationId id);
+
+    //advances every running animation
+    void update(float dt);
+
+    //animations that reached their last frame during the last update
+    const std::vector<AnimationId>& getCompleted() const;
+
+    //per animation controls, same meaning as on Animation
+    void play(AnimationId id);
+    void stop(AnimationId id);
+    void setHoldFrame(AnimationId id, int frame);
+    void setCurrentFrame(AnimationId id, int frame);
+
+    //gettors
+    bool isAlive(AnimationId id) const; //false once removed, even after the slot is reused
+    const AtlasRegion& getCurrentRegion(AnimationId id) const;
+    int getCurrentFrame(AnimationId id) const;
+    bool getIsRunning(AnimationId id) const;
+    unsigned int getCount() const;
+
+private:
+    //ids are laid out like ResourcePool handles, 20 bits of slot and 12 of generation
+    static constexpr unsigned int ID_INDEX_BITS = 20;
+    static constexpr unsigned int ID_INDEX_MASK = (1u << ID_INDEX_BITS) - 1;
+    static constexpr unsigned int MAX_GENERATION = (1u << (32 - ID_INDEX_BITS)) - 1;
+    static constexpr unsigned int NONE = 0xFFFFFFFF;
+
+    unsigned int addFrames(const std::vector<AtlasRegion>& frames);
+    unsigned int indexOf(AnimationId id) const { return sparse_[id & ID_INDEX_MASK]; }
+
+    //dense arrays, index i in each of them is the same animation
+    std::vector<float> timers_;          // time left before the next frame
+    std::vector<float> durations_;       // how long each frame is displayed
+    std::vector<int> frames_;            // the loops_ counter from Animation
+    std::vector<int> frameCounts_;       // frames in this animation
+    std::vector<int> holdFrames_;        // frame to hold on, 0 for none
+    std::vector<unsigned int> firstFrame_; // index of frame 0 in regions_
+    std::vector<unsigned int> current_;  // index in regions_ of the shown frame
+    std::vector<unsigned char> running_; // whether this animation advances
+    std::vector<unsigned char> looping_; // whether it wraps instead of completing
+    std::vector<AnimationId> ids_;       // id of the animation at each dense index
+
+    std::vector<unsigned int> sparse_;   // id slot to dense index, NONE when removed
+    std::vector<unsigned int> generations_; // per slot, has to match the id's
+    std::vector<unsigned int> freeSlots_; // slots ready for reuse
+    std::vector<AtlasRegion> regions_;   // frames of every animation, back to back
+    std::vector<AnimationId> completed_; // filled by update, reserved up front
+};
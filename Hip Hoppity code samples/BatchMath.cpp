@@ -0,0 +1,430 @@
+/*
+ * file: BatchMath.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the BatchMath class,
+ *        this holds the scalar, SSE2 and AVX2 kernels and picks one at runtime.
+ */
+
+#include "BatchMath.h"
+#include <cmath>
+#include <emmintrin.h> // SSE2
+#include <immintrin.h> // AVX2, only called after the cpu check
+#ifdef _MSC_VER
+#include <intrin.h>    // __cpuid, _xgetbv
+#endif
+
+/* Use Notes:
+
+MSVC compiles AVX2 intrinsics in any file, other compilers need the target
+attribute on each function that uses them. Nothing in here needs /arch flags,
+the AVX2 kernels are only ever called when the CPU and OS support them.
+
+Matrices are read as 16 floats, column major like glm.
+
+*/
+
+#ifdef _MSC_VER
+#define BATCH_AVX2
+#else
+#define BATCH_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+//helper, AVX2 and FMA on the CPU and AVX state saved by the OS
+static bool cpuHasAVX2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma || (_xgetbv(0) & 6) != 6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+//scalar kernels, also used for the leftovers of the wide ones
+
+static void transformPointsScalar(const float* m, const BatchMath::Vec3Arrays& in, const BatchMath::Vec3Arrays& out,
+    size_t first, size_t count)
+{
+    for (size_t i = first; i < count; ++i)
+    {
+        float x = in.x[i], y = in.y[i], z = in.z[i];
+        out.x[i] = m[0] * x + m[4] * y + m[8] * z + m[12];
+        out.y[i] = m[1] * x + m[5] * y + m[9] * z + m[13];
+        out.z[i] = m[2] * x + m[6] * y + m[10] * z + m[14];
+    }
+}
+
+static void transformVectorsScalar(const float* m, const BatchMath::Vec3Arrays& in, const BatchMath::Vec3Arrays& out,
+    size_t first, size_t count)
+{
+    for (size_t i = first; i < count; ++i)
+    {
+        float x = in.x[i], y = in.y[i], z = in.z[i];
+        out.x[i] = m[0] * x + m[4] * y + m[8] * z;
+        out.y[i] = m[1] * x + m[5] * y + m[9] * z;
+        out.z[i] = m[2] * x + m[6] * y + m[10] * z;
+    }
+}
+
+static void transformScalar(const float* m, const glm::vec4* in, glm::vec4* out, size_t first, size_t count)
+{
+    for (size_t i = first; i < count; ++i)
+    {
+        glm::vec4 v = in[i];
+        out[i] = glm::vec4(m[0] * v.x + m[4] * v.y + m[8] * v.z + m[12] * v.w,
+                           m[1] * v.x + m[5] * v.y + m[9] * v.z + m[13] * v.w,
+                           m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14] * v.w,
+                           m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15] * v.w);
+    }
+}
+
+static void boundsScalar(const BatchMath::Vec3Arrays& in, size_t first, size_t count, float* min, float* max)
+{
+    for (size_t i = first; i < count; ++i)
+    {
+        min[0] = in.x[i] < min[0] ? in.x[i] : min[0];
+        min[1] = in.y[i] < min[1] ? in.y[i] : min[1];
+        min[2] = in.z[i] < min[2] ? in.z[i] : min[2];
+        max[0] = in.x[i] > max[0] ? in.x[i] : max[0];
+        max[1] = in.y[i] > max[1] ? in.y[i] : max[1];
+        max[2] = in.z[i] > max[2] ? in.z[i] : max[2];
+    }
+}
+
+static void normalizeScalar(const BatchMath::Vec3Arrays& in, const BatchMath::Vec3Arrays& out, size_t first, size_t count)
+{
+    for (size_t i = first; i < count; ++i)
+    {
+        float x = in.x[i], y = in.y[i], z = in.z[i];
+        float lengthSquared = x * x + y * y + z * z;
+        float scale = lengthSquared > 0 ? 1.0f / sqrtf(lengthSquared) : 0.0f;
+        out.x[i] = x * scale;
+        out.y[i] = y * scale;
+        out.z[i] = z * scale;
+    }
+}
+
+//SSE2 kernels, 4 elements at a time
+
+static void transformPointsSSE2(const float* m, const BatchMath::Vec3Arrays& in, const BatchMath::Vec3Arrays& out,
+    size_t count)
+{
+    __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+    __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+    __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+    __m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(in.x + i), y = _mm_loadu_ps(in.y + i), z = _mm_loadu_ps(in.z + i);
+        _mm_storeu_ps(out.x + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m4, y)), _mm_add_ps(_mm_mul_ps(m8, z), m12)));
+        _mm_storeu_ps(out.y + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, x), _mm_mul_ps(m5, y)), _mm_add_ps(_mm_mul_ps(m9, z), m13)));
+        _mm_storeu_ps(out.z + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, x), _mm_mul_ps(m6, y)), _mm_add_ps(_mm_mul_ps(m10, z), m14)));
+    }
+    transformPointsScalar(m, in, out, i, count);
+}
+
+static void transformVectorsSSE2(const float* m, const BatchMath::Vec3Arrays& in, const BatchMath::Vec3Arrays& out,
+    size_t count)
+{
+    __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+    __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+    __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(in.x + i), y = _mm_loadu_ps(in.y + i), z = _mm_loadu_ps(in.z + i);
+        _mm_storeu_ps(out.x + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m4, y)), _mm_mul_ps(m8, z)));
+        _mm_storeu_ps(out.y + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, x), _mm_mul_ps(m5, y)), _mm_mul_ps(m9, z)));
+        _mm_storeu_ps(out.z + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, x), _mm_mul_ps(m6, y)), _mm_mul_ps(m10, z)));
+    }
+    transformVectorsScalar(m, in, out, i, count);
+}
+
+static void transformSSE2(const float* m, const glm::vec4* in, glm::vec4* out, size_t count)
+{
+    __m128 c0 = _mm_loadu_ps(m), c1 = _mm_loadu_ps(m + 4), c2 = _mm_loadu_ps(m + 8), c3 = _mm_loadu_ps(m + 12);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        __m128 v = _mm_loadu_ps(&in[i].x);
+        __m128 x = _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+        __m128 y = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+        __m128 z = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+        __m128 w = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+        _mm_storeu_ps(&out[i].x, _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, x), _mm_mul_ps(c1, y)),
+                                            _mm_add_ps(_mm_mul_ps(c2, z), _mm_mul_ps(c3, w))));
+    }
+}
+
+static void boundsSSE2(const BatchMath::Vec3Arrays& in, size_t count, float* min, float* max)
+{
+    size_t i = 0;
+    if (count >= 4)
+    {
+        __m128 minX = _mm_loadu_ps(in.x), minY = _mm_loadu_ps(in.y), minZ = _mm_loadu_ps(in.z);
+        __m128 maxX = minX, maxY = minY, maxZ = minZ;
+
+        for (i = 4; i + 4 <= count; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(in.x + i), y = _mm_loadu_ps(in.y + i), z = _mm_loadu_ps(in.z + i);
+            minX = _mm_min_ps(minX, x); maxX = _mm_max_ps(maxX, x);
+            minY = _mm_min_ps(minY, y); maxY = _mm_max_ps(maxY, y);
+            minZ = _mm_min_ps(minZ, z); maxZ = _mm_max_ps(maxZ, z);
+        }
+
+        alignas(16) float lanes[6][4];
+        _mm_store_ps(lanes[0], minX); _mm_store_ps(lanes[1], minY); _mm_store_ps(lanes[2], minZ);
+        _mm_store_ps(lanes[3], maxX); _mm_store_ps(lanes[4], maxY); _mm_store_ps(lanes[5], maxZ);
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                min[axis] = lanes[axis][lane] < min[axis] ? lanes[axis][lane] : min[axis];
+                max[axis] = lanes[axis + 3][lane] > max[axis] ? lanes[axis + 3][lane] : max[axis];
+            }
+        }
+    }
+    boundsScalar(in, i, count, min, max);
+}
+
+static void normalizeSSE2(const BatchMath::Vec3Arrays& in, const BatchMath::Vec3Arrays& out, size_t count)
+{
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(in.x + i), y = _mm_loadu_ps(in.y + i), z = _mm_loadu_ps(in.z + i);
+        __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+
+        // full precision divide, rsqrt alone is only good to about 12 bits
+        __m128 nonZero = _mm_cmpgt_ps(lengthSquared, zero);
+        __m128 scale = _mm_and_ps(nonZero, _mm_div_ps(one, _mm_sqrt_ps(_mm_or_ps(lengthSquared, _mm_andnot_ps(nonZero, one)))));
+        _mm_storeu_ps(out.x + i, _mm_mul_ps(x, scale));
+        _mm_storeu_ps(out.y + i, _mm_mul_ps(y, scale));
+        _mm_storeu_ps(out.z + i, _mm_mul_ps(z, scale));
+    }
+    normalizeScalar(in, out, i, count);
+}
+
+//AVX2 kernels, 8 elements at a time with fused multiply adds
+
+BATCH_AVX2 static void transformPointsAVX2(const float* m, const BatchMath::Vec3Arrays& in, const BatchMath::Vec3Arrays& out,
+    size_t count)
+{
+    __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+    __m256 m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]), m6 = _mm256_set1_ps(m[6]);
+    __m256 m8 = _mm256_set1_ps(m[8]), m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]);
+    __m256 m12 = _mm256_set1_ps(m[12]), m13 = _mm256_set1_ps(m[13]), m14 = _mm256_set1_ps(m[14]);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(in.x + i), y = _mm256_loadu_ps(in.y + i), z = _mm256_loadu_ps(in.z + i);
+        _mm256_storeu_ps(out.x + i, _mm256_fmadd_ps(m0, x, _mm256_fmadd_ps(m4, y, _mm256_fmadd_ps(m8, z, m12))));
+        _mm256_storeu_ps(out.y + i, _mm256_fmadd_ps(m1, x, _mm256_fmadd_ps(m5, y, _mm256_fmadd_ps(m9, z, m13))));
+        _mm256_storeu_ps(out.z + i, _mm256_fmadd_ps(m2, x, _mm256_fmadd_ps(m6, y, _mm256_fmadd_ps(m10, z, m14))));
+    }
+    transformPointsScalar(m, in, out, i, count);
+}
+
+BATCH_AVX2 static void transformVectorsAVX2(const float* m, const BatchMath::Vec3Arrays& in, const BatchMath::Vec3Arrays& out,
+    size_t count)
+{
+    __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+    __m256 m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]), m6 = _mm256_set1_ps(m[6]);
+    __m256 m8 = _mm256_set1_ps(m[8]), m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(in.x + i), y = _mm256_loadu_ps(in.y + i), z = _mm256_loadu_ps(in.z + i);
+        _mm256_storeu_ps(out.x + i, _mm256_fmadd_ps(m0, x, _mm256_fmadd_ps(m4, y, _mm256_mul_ps(m8, z))));
+        _mm256_storeu_ps(out.y + i, _mm256_fmadd_ps(m1, x, _mm256_fmadd_ps(m5, y, _mm256_mul_ps(m9, z))));
+        _mm256_storeu_ps(out.z + i, _mm256_fmadd_ps(m2, x, _mm256_fmadd_ps(m6, y, _mm256_mul_ps(m10, z))));
+    }
+    transformVectorsScalar(m, in, out, i, count);
+}
+
+//two vec4 per register, the matrix columns are repeated in both halves
+BATCH_AVX2 static void transformAVX2(const float* m, const glm::vec4* in, glm::vec4* out, size_t count)
+{
+    __m256 c0 = _mm256_broadcast_ps((const __m128*)m);
+    __m256 c1 = _mm256_broadcast_ps((const __m128*)(m + 4));
+    __m256 c2 = _mm256_broadcast_ps((const __m128*)(m + 8));
+    __m256 c3 = _mm256_broadcast_ps((const __m128*)(m + 12));
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        __m256 v = _mm256_loadu_ps(&in[i].x);
+        __m256 x = _mm256_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0));
+        __m256 y = _mm256_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1));
+        __m256 z = _mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2));
+        __m256 w = _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3));
+        _mm256_storeu_ps(&out[i].x, _mm256_fmadd_ps(c0, x, _mm256_fmadd_ps(c1, y, _mm256_fmadd_ps(c2, z, _mm256_mul_ps(c3, w)))));
+    }
+    transformScalar(m, in, out, i, count);
+}
+
+BATCH_AVX2 static void boundsAVX2(const BatchMath::Vec3Arrays& in, size_t count, float* min, float* max)
+{
+    size_t i = 0;
+    if (count >= 8)
+    {
+        __m256 minX = _mm256_loadu_ps(in.x), minY = _mm256_loadu_ps(in.y), minZ = _mm256_loadu_ps(in.z);
+        __m256 maxX = minX, maxY = minY, maxZ = minZ;
+
+        for (i = 8; i + 8 <= count; i += 8)
+        {
+            __m256 x = _mm256_loadu_ps(in.x + i), y = _mm256_loadu_ps(in.y + i), z = _mm256_loadu_ps(in.z + i);
+            minX = _mm256_min_ps(minX, x); maxX = _mm256_max_ps(maxX, x);
+            minY = _mm256_min_ps(minY, y); maxY = _mm256_max_ps(maxY, y);
+            minZ = _mm256_min_ps(minZ, z); maxZ = _mm256_max_ps(maxZ, z);
+        }
+
+        alignas(32) float lanes[6][8];
+        _mm256_store_ps(lanes[0], minX); _mm256_store_ps(lanes[1], minY); _mm256_store_ps(lanes[2], minZ);
+        _mm256_store_ps(lanes[3], maxX); _mm256_store_ps(lanes[4], maxY); _mm256_store_ps(lanes[5], maxZ);
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                min[axis] = lanes[axis][lane] < min[axis] ? lanes[axis][lane] : min[axis];
+                max[axis] = lanes[axis + 3][lane] > max[axis] ? lanes[axis + 3][lane] : max[axis];
+            }
+        }
+    }
+    boundsScalar(in, i, count, min, max);
+}
+
+BATCH_AVX2 static void normalizeAVX2(const BatchMath::Vec3Arrays& in, const BatchMath::Vec3Arrays& out, size_t count)
+{
+    __m256 zero = _mm256_setzero_ps();
+    __m256 one = _mm256_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(in.x + i), y = _mm256_loadu_ps(in.y + i), z = _mm256_loadu_ps(in.z + i);
+        __m256 lengthSquared = _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z)));
+
+        __m256 nonZero = _mm256_cmp_ps(lengthSquared, zero, _CMP_GT_OQ);
+        __m256 safe = _mm256_blendv_ps(one, lengthSquared, nonZero);
+        __m256 scale = _mm256_and_ps(nonZero, _mm256_div_ps(one, _mm256_sqrt_ps(safe)));
+        _mm256_storeu_ps(out.x + i, _mm256_mul_ps(x, scale));
+        _mm256_storeu_ps(out.y + i, _mm256_mul_ps(y, scale));
+        _mm256_storeu_ps(out.z + i, _mm256_mul_ps(z, scale));
+    }
+    normalizeScalar(in, out, i, count);
+}
+
+//dispatch
+
+static BatchMath::Level& currentLevel()
+{
+    static BatchMath::Level level = BatchMath::supportedLevel();
+    return level;
+}
+
+void BatchMath::transformPoints(const glm::mat4& matrix, const Vec3Arrays& in, const Vec3Arrays& out, size_t count)
+{
+    const float* m = &matrix[0][0];
+    switch (currentLevel())
+    {
+    case AVX2: transformPointsAVX2(m, in, out, count); break;
+    case SSE2: transformPointsSSE2(m, in, out, count); break;
+    default:   transformPointsScalar(m, in, out, 0, count); break;
+    }
+}
+
+void BatchMath::transformVectors(const glm::mat4& matrix, const Vec3Arrays& in, const Vec3Arrays& out, size_t count)
+{
+    const float* m = &matrix[0][0];
+    switch (currentLevel())
+    {
+    case AVX2: transformVectorsAVX2(m, in, out, count); break;
+    case SSE2: transformVectorsSSE2(m, in, out, count); break;
+    default:   transformVectorsScalar(m, in, out, 0, count); break;
+    }
+}
+
+void BatchMath::transform(const glm::mat4& matrix, const glm::vec4* in, glm::vec4* out, size_t count)
+{
+    const float* m = &matrix[0][0];
+    switch (currentLevel())
+    {
+    case AVX2: transformAVX2(m, in, out, count); break;
+    case SSE2: transformSSE2(m, in, out, count); break;
+    default:   transformScalar(m, in, out, 0, count); break;
+    }
+}
+
+void BatchMath::bounds(const Vec3Arrays& in, size_t count, glm::vec3& min, glm::vec3& max)
+{
+    float low[3] = { INFINITY, INFINITY, INFINITY };
+    float high[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+    switch (currentLevel())
+    {
+    case AVX2: boundsAVX2(in, count, low, high); break;
+    case SSE2: boundsSSE2(in, count, low, high); break;
+    default:   boundsScalar(in, 0, count, low, high); break;
+    }
+
+    min = glm::vec3(low[0], low[1], low[2]);
+    max = glm::vec3(high[0], high[1], high[2]);
+}
+
+void BatchMath::normalize(const Vec3Arrays& in, const Vec3Arrays& out, size_t count)
+{
+    switch (currentLevel())
+    {
+    case AVX2: normalizeAVX2(in, out, count); break;
+    case SSE2: normalizeSSE2(in, out, count); break;
+    default:   normalizeScalar(in, out, 0, count); break;
+    }
+}
+
+//x64 always has SSE2, the check is only for AVX2
+BatchMath::Level BatchMath::supportedLevel()
+{
+    static const Level supported = cpuHasAVX2() ? AVX2 : SSE2;
+    return supported;
+}
+
+BatchMath::Level BatchMath::getLevel()
+{
+    return currentLevel();
+}
+
+void BatchMath::setLevel(Level level)
+{
+    currentLevel() = level > supportedLevel() ? supportedLevel() : level;
+}
+
+const char* BatchMath::levelName(Level level)
+{
+    switch (level)
+    {
+    case AVX2: return "AVX2";
+    case SSE2: return "SSE2";
+    default:   return "scalar";
+    }
+}
@@ -0,0 +1,69 @@
+/*
+ * file: BatchMath.h
+ * author: Mark Kouris
+ * brief: the interface of the BatchMath class.
+ *        Array versions of the few glm operations that run over whole meshes
+ *        or sprite lists: transforming points and normals, bounds and
+ *        normalizing. Each one has a scalar, SSE2 and AVX2 kernel and the
+ *        best one the CPU supports is picked the first time any is called.
+ *
+ */
+#pragma once
+#include "glm/glm/glm.hpp"
+#include <cstddef> // size_t
+
+/* Use Notes:
+
+Arrays are structure of arrays, one float array per component:
+
+    std::vector<float> xs, ys, zs;
+    BatchMath::Vec3Arrays positions = { xs.data(), ys.data(), zs.data() };
+    BatchMath::transformPoints(model, positions, positions, xs.size());
+
+An array of structures of arrays (blocks of 8 x, then 8 y, then 8 z) works too,
+pass each block as its own Vec3Arrays with a count of 8, or the whole buffer
+when the blocks are laid out back to back per component.
+
+In and out may be the same arrays. No alignment is required, aligned data
+is only a little faster. glm::vec4 arrays (like OBJ vertex buffers) can use
+the array of structures transform instead.
+
+*/
+
+class BatchMath
+{
+public:
+    enum Level { SCALAR, SSE2, AVX2 };
+
+    //one float array per component
+    struct Vec3Arrays
+    {
+        float* x;
+        float* y;
+        float* z;
+    };
+
+    //out = matrix * (in, 1), for affine matrices (the w row is ignored)
+    static void transformPoints(const glm::mat4& matrix, const Vec3Arrays& in, const Vec3Arrays& out, size_t count);
+
+    //out = matrix * (in, 0), for normals pass the inverse transpose
+    static void transformVectors(const glm::mat4& matrix, const Vec3Arrays& in, const Vec3Arrays& out, size_t count);
+
+    //out = matrix * in for glm::vec4 arrays, full 4x4
+    static void transform(const glm::mat4& matrix, const glm::vec4* in, glm::vec4* out, size_t count);
+
+    //smallest box around the points, min > max when count is 0
+    static void bounds(const Vec3Arrays& in, size_t count, glm::vec3& min, glm::vec3& max);
+
+    //out = normalize(in), zero length vectors stay zero
+    static void normalize(const Vec3Arrays& in, const Vec3Arrays& out, size_t count);
+
+    //what the CPU supports, and what is being used
+    static Level supportedLevel();
+    static Level getLevel();
+
+    //forces a level, benchmarks use this. Asking for more than the CPU has falls back
+    static void setLevel(Level level);
+
+    static const char* levelName(Level level);
+};
@@ -0,0 +1,183 @@
+/*
+ * file: BatchMathBench.cpp
+ * author: Mark Kouris
+ * brief: command line microbenchmark for BatchMath. Times every kernel at
+ *        every level the CPU supports against the plain glm loop it replaces,
+ *        and checks the results agree with glm.
+ */
+
+#include "BatchMath.h"
+#include <algorithm> // std::min, std::max
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+/* Use Notes:
+
+BatchMathBench [count] [repeats]
+    count defaults to 100000 elements, repeats to 200.
+
+Prints nanoseconds per element for the glm baseline and each level, the
+speedup over glm and the largest difference from the glm result. Build
+with optimizations on, a debug build only measures the debug runtime.
+
+*/
+
+//helper, best of repeats in nanoseconds per element, the best run has the least noise
+static double timeIt(const std::function<void()>& work, size_t count, int repeats)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        work();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ns / (double)count);
+    }
+    return best;
+}
+
+//helper, largest difference between glm's answer and ours
+static float maxError(const std::vector<glm::vec3>& expected, const std::vector<float>& x,
+    const std::vector<float>& y, const std::vector<float>& z)
+{
+    float error = 0;
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        error = std::max(error, std::fabs(expected[i].x - x[i]));
+        error = std::max(error, std::fabs(expected[i].y - y[i]));
+        error = std::max(error, std::fabs(expected[i].z - z[i]));
+    }
+    return error;
+}
+
+static void report(const char* kernel, const char* level, double ns, double baseline, float error)
+{
+    printf("%-18s %-7s %8.3f ns  %6.2fx  max error %g\n", kernel, level, ns, baseline / ns, error);
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? (size_t)std::stoul(argv[1]) : 100000;
+    int repeats = argc > 2 ? std::stoi(argv[2]) : 200;
+
+    //glm side is arrays of structures, ours is structure of arrays holding the same values
+    std::vector<glm::vec3> points(count);
+    std::vector<glm::vec4> points4(count);
+    std::vector<float> xs(count), ys(count), zs(count);
+    srand(1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        points[i] = glm::vec3(rand() / (float)RAND_MAX * 200 - 100, rand() / (float)RAND_MAX * 200 - 100,
+                              rand() / (float)RAND_MAX * 200 - 100);
+        points4[i] = glm::vec4(points[i], 1.0f);
+        xs[i] = points[i].x;
+        ys[i] = points[i].y;
+        zs[i] = points[i].z;
+    }
+
+    glm::mat4 matrix(1.0f);
+    matrix[0] = glm::vec4(0.8f, 0.6f, 0.0f, 0.0f);
+    matrix[1] = glm::vec4(-0.6f, 0.8f, 0.0f, 0.0f);
+    matrix[2] = glm::vec4(0.0f, 0.0f, 2.0f, 0.0f);
+    matrix[3] = glm::vec4(5.0f, -3.0f, 1.0f, 1.0f);
+
+    std::vector<glm::vec3> expected(count);
+    std::vector<glm::vec4> expected4(count), out4(count);
+    std::vector<float> ox(count), oy(count), oz(count);
+    BatchMath::Vec3Arrays in = { xs.data(), ys.data(), zs.data() };
+    BatchMath::Vec3Arrays out = { ox.data(), oy.data(), oz.data() };
+
+    printf("%zu elements, best of %d, cpu supports %s\n\n", count, repeats,
+        BatchMath::levelName(BatchMath::supportedLevel()));
+
+    std::vector<BatchMath::Level> levels;
+    for (int level = BatchMath::SCALAR; level <= BatchMath::supportedLevel(); ++level)
+        levels.push_back((BatchMath::Level)level);
+
+    //transformPoints
+    double baseline = timeIt([&] {
+        for (size_t i = 0; i < count; ++i)
+            expected[i] = glm::vec3(matrix * glm::vec4(points[i], 1.0f));
+    }, count, repeats);
+    report("transformPoints", "glm", baseline, baseline, 0);
+    for (BatchMath::Level level : levels)
+    {
+        BatchMath::setLevel(level);
+        double ns = timeIt([&] { BatchMath::transformPoints(matrix, in, out, count); }, count, repeats);
+        report("transformPoints", BatchMath::levelName(level), ns, baseline, maxError(expected, ox, oy, oz));
+    }
+
+    //transformVectors
+    baseline = timeIt([&] {
+        for (size_t i = 0; i < count; ++i)
+            expected[i] = glm::vec3(matrix * glm::vec4(points[i], 0.0f));
+    }, count, repeats);
+    report("transformVectors", "glm", baseline, baseline, 0);
+    for (BatchMath::Level level : levels)
+    {
+        BatchMath::setLevel(level);
+        double ns = timeIt([&] { BatchMath::transformVectors(matrix, in, out, count); }, count, repeats);
+        report("transformVectors", BatchMath::levelName(level), ns, baseline, maxError(expected, ox, oy, oz));
+    }
+
+    //transform, arrays of vec4
+    baseline = timeIt([&] {
+        for (size_t i = 0; i < count; ++i)
+            expected4[i] = matrix * points4[i];
+    }, count, repeats);
+    report("transform (vec4)", "glm", baseline, baseline, 0);
+    for (BatchMath::Level level : levels)
+    {
+        BatchMath::setLevel(level);
+        double ns = timeIt([&] { BatchMath::transform(matrix, points4.data(), out4.data(), count); }, count, repeats);
+        float error = 0;
+        for (size_t i = 0; i < count; ++i)
+            for (int c = 0; c < 4; ++c)
+                error = std::max(error, std::fabs(expected4[i][c] - out4[i][c]));
+        report("transform (vec4)", BatchMath::levelName(level), ns, baseline, error);
+    }
+
+    //bounds
+    glm::vec3 expectedMin, expectedMax;
+    baseline = timeIt([&] {
+        expectedMin = glm::vec3(INFINITY);
+        expectedMax = glm::vec3(-INFINITY);
+        for (size_t i = 0; i < count; ++i)
+        {
+            expectedMin = glm::min(expectedMin, points[i]);
+            expectedMax = glm::max(expectedMax, points[i]);
+        }
+    }, count, repeats);
+    report("bounds", "glm", baseline, baseline, 0);
+    for (BatchMath::Level level : levels)
+    {
+        BatchMath::setLevel(level);
+        glm::vec3 min, max;
+        double ns = timeIt([&] { BatchMath::bounds(in, count, min, max); }, count, repeats);
+        float error = 0;
+        for (int c = 0; c < 3; ++c)
+            error = std::max(error, std::max(std::fabs(min[c] - expectedMin[c]), std::fabs(max[c] - expectedMax[c])));
+        report("bounds", BatchMath::levelName(level), ns, baseline, error);
+    }
+
+    //normalize
+    baseline = timeIt([&] {
+        for (size_t i = 0; i < count; ++i)
+            expected[i] = glm::normalize(points[i]);
+    }, count, repeats);
+    report("normalize", "glm", baseline, baseline, 0);
+    for (BatchMath::Level level : levels)
+    {
+        BatchMath::setLevel(level);
+        double ns = timeIt([&] { BatchMath::normalize(in, out, count); }, count, repeats);
+        report("normalize", BatchMath::levelName(level), ns, baseline, maxError(expected, ox, oy, oz));
+    }
+
+    BatchMath::setLevel(BatchMath::supportedLevel());
+    return 0;
+}
@@ -0,0 +1,514 @@
+/*
+ * file: BlockCompression.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the block compression encoders and decoders.
+ *        Endpoints come from the principal axis of the block's colors, texels
+ *        then pick the nearest palette entry. This is meant for offline baking,
+ *        it trades a little quality for being simple and fast enough to run on
+ *        every asset in a build.
+ */
+
+#include "BlockCompression.h"
+#include <cmath>
+#include <cstring> // memset
+
+//GL enums, so the tool does not need a GL header
+#define COMPRESSED_RGBA_S3TC_DXT1 0x83F1
+#define COMPRESSED_RGBA_S3TC_DXT5 0x83F3
+#define COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+
+namespace
+{
+    //endpoints along the principal axis of the given texels,
+    //channels is 3 for rgb or 4 for rgba, mask skips texels when not null
+    void principalEndpoints(const unsigned char texels[64], int channels, const bool* mask,
+        float low[4], float high[4])
+    {
+        float mean[4] = { 0, 0, 0, 0 };
+        int count = 0;
+
+        for (int i = 0; i < 16; ++i)
+        {
+            if (mask && !mask[i])
+                continue;
+            for (int c = 0; c < channels; ++c)
+                mean[c] += texels[i * 4 + c];
+            ++count;
+        }
+
+        if (count == 0)
+        {
+            for (int c = 0; c < 4; ++c)
+                low[c] = high[c] = 0.f;
+            return;
+        }
+
+        for (int c = 0; c < channels; ++c)
+            mean[c] /= (float)count;
+
+        //covariance of the texels around the mean
+        float cov[4][4] = {};
+        for (int i = 0; i < 16; ++i)
+        {
+            if (mask && !mask[i])
+                continue;
+            float d[4];
+            for (int c = 0; c < channels; ++c)
+                d[c] = texels[i * 4 + c] - mean[c];
+            for (int a = 0; a < channels; ++a)
+                for (int b = 0; b < channels; ++b)
+                    cov[a][b] += d[a] * d[b];
+        }
+
+        //power iteration, a handful of steps is plenty for 16 points
+        float axis[4] = { 1.f, 1.f, 1.f, 1.f };
+        for (int step = 0; step < 8; ++step)
+        {
+            float next[4] = { 0, 0, 0, 0 };
+            float length = 0.f;
+            for (int a = 0; a < channels; ++a)
+            {
+                for (int b = 0; b < channels; ++b)
+                    next[a] += cov[a][b] * axis[b];
+                length += next[a] * next[a];
+            }
+
+            length = std::sqrt(length);
+            if (length < 1e-6f)
+                break;
+            for (int a = 0; a < channels; ++a)
+                axis[a] = next[a] / length;
+        }
+
+        //project onto the axis and keep the extremes
+        float minT = 1e30f;
+        float maxT = -1e30f;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (mask && !mask[i])
+                continue;
+            float t = 0.f;
+            for (int c = 0; c < channels; ++c)
+                t += (texels[i * 4 + c] - mean[c]) * axis[c];
+            minT = std::fmin(minT, t);
+            maxT = std::fmax(maxT, t);
+        }
+
+        for (int c = 0; c < 4; ++c)
+        {
+            low[c] = c < channels ? std::fmin(std::fmax(mean[c] + axis[c] * minT, 0.f), 255.f) : 255.f;
+            high[c] = c < channels ? std::fmin(std::fmax(mean[c] + axis[c] * maxT, 0.f), 255.f) : 255.f;
+        }
+    }
+
+    int squaredDistance(const unsigned char* a, const int* b, int channels)
+    {
+        int sum = 0;
+        for (int c = 0; c < channels; ++c)
+        {
+            int d = (int)a[c] - b[c];
+            sum += d * d;
+        }
+        return sum;
+    }
+
+    unsigned short pack565(const float color[4])
+    {
+        int r = (int)(color[0] * 31.f / 255.f + 0.5f);
+        int g = (int)(color[1] * 63.f / 255.f + 0.5f);
+        int b = (int)(color[2] * 31.f / 255.f + 0.5f);
+        return (unsigned short)((r << 11) | (g << 5) | b);
+    }
+
+    void unpack565(unsigned short packed, int color[4])
+    {
+        int r = (packed >> 11) & 31;
+        int g = (packed >> 5) & 63;
+        int b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+        color[3] = 255;
+    }
+
+    //builds the 4 entry palette the decoder will see for these endpoints
+    void colorPalette(unsigned short c0, unsigned short c1, bool fourColor, int palette[4][4])
+    {
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+
+        for (int c = 0; c < 3; ++c)
+        {
+            if (fourColor)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            else
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        palette[2][3] = 255;
+        palette[3][3] = fourColor ? 255 : 0;
+    }
+
+    //the color half of BC1 and BC3, punchThrough allows the transparent entry
+    void encodeColor(const unsigned char texels[64], unsigned char block[8], bool punchThrough)
+    {
+        bool opaque[16];
+        bool anyTransparent = false;
+        for (int i = 0; i < 16; ++i)
+        {
+            opaque[i] = !punchThrough || texels[i * 4 + 3] >= 128;
+            anyTransparent |= !opaque[i];
+        }
+
+        float low[4], high[4];
+        principalEndpoints(texels, 3, opaque, low, high);
+
+        unsigned short c0 = pack565(high);
+        unsigned short c1 = pack565(low);
+
+        //c0 > c1 picks the 4 color palette, c0 <= c1 the one with transparency
+        bool fourColor = !anyTransparent;
+        if ((fourColor && c0 < c1) || (!fourColor && c0 > c1))
+        {
+            unsigned short swap = c0;
+            c0 = c1;
+            c1 = swap;
+        }
+
+        //equal endpoints read back as the 3 color palette, all its colors match anyway
+        int palette[4][4];
+        colorPalette(c0, c1, c0 > c1, palette);
+        int entries = c0 > c1 ? 4 : 3;
+
+        unsigned int indices = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            unsigned int best = 3;
+            if (opaque[i])
+            {
+                int bestError = 1 << 30;
+                for (int p = 0; p < entries; ++p)
+                {
+                    int error = squaredDistance(texels + i * 4, palette[p], 3);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = (unsigned int)p;
+                    }
+                }
+            }
+            indices |= best << (2 * i);
+        }
+
+        block[0] = (unsigned char)(c0 & 0xFF);
+        block[1] = (unsigned char)(c0 >> 8);
+        block[2] = (unsigned char)(c1 & 0xFF);
+        block[3] = (unsigned char)(c1 >> 8);
+        block[4] = (unsigned char)(indices & 0xFF);
+        block[5] = (unsigned char)((indices >> 8) & 0xFF);
+        block[6] = (unsigned char)((indices >> 16) & 0xFF);
+        block[7] = (unsigned char)(indices >> 24);
+    }
+
+    void decodeColor(const unsigned char block[8], unsigned char texels[64], bool allowPunchThrough)
+    {
+        unsigned short c0 = (unsigned short)(block[0] | (block[1] << 8));
+        unsigned short c1 = (unsigned short)(block[2] | (block[3] << 8));
+        unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+
+        int palette[4][4];
+        colorPalette(c0, c1, !allowPunchThrough || c0 > c1, palette);
+
+        for (int i = 0; i < 16; ++i)
+        {
+            const int* color = palette[(indices >> (2 * i)) & 3];
+            for (int c = 0; c < 4; ++c)
+                texels[i * 4 + c] = (unsigned char)color[c];
+        }
+    }
+
+    //128 bit little endian bit stream for BC7
+    struct bitWriter
+    {
+        unsigned char* data;
+        unsigned int position = 0;
+
+        void write(unsigned int value, unsigned int bits)
+        {
+            for (unsigned int i = 0; i < bits; ++i, ++position)
+            {
+                if ((value >> i) & 1)
+                    data[position >> 3] |= (unsigned char)(1 << (position & 7));
+            }
+        }
+    };
+
+    struct bitReader
+    {
+        const unsigned char* data;
+        unsigned int position = 0;
+
+        unsigned int read(unsigned int bits)
+        {
+            unsigned int value = 0;
+            for (unsigned int i = 0; i < bits; ++i, ++position)
+                value |= (unsigned int)((data[position >> 3] >> (position & 7)) & 1) << i;
+            return value;
+        }
+    };
+
+    const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    //7 bit endpoint plus shared p bit, picks the p bit that lands closest
+    void quantizeMode6(const float endpoint[4], int quantized[4], int& pBit)
+    {
+        int bestError = 1 << 30;
+        for (int p = 0; p < 2; ++p)
+        {
+            int values[4];
+            int error = 0;
+            for (int c = 0; c < 4; ++c)
+            {
+                int v = (int)std::floor((endpoint[c] - p) / 2.f + 0.5f);
+                v = v < 0 ? 0 : (v > 127 ? 127 : v);
+                values[c] = v;
+                int d = ((v << 1) | p) - (int)(endpoint[c] + 0.5f);
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pBit = p;
+                for (int c = 0; c < 4; ++c)
+                    quantized[c] = values[c];
+            }
+        }
+    }
+}
+
+namespace BlockCompression
+{
+    unsigned int blockBytes(Format format)
+    {
+        return format == BC1 ? 8 : 16;
+    }
+
+    unsigned int glFormat(Format format)
+    {
+        switch (format)
+        {
+        case BC1: return COMPRESSED_RGBA_S3TC_DXT1;
+        case BC3: return COMPRESSED_RGBA_S3TC_DXT5;
+        default:  return COMPRESSED_RGBA_BPTC_UNORM;
+        }
+    }
+
+    void encodeBC1(const unsigned char texels[64], unsigned char block[8])
+    {
+        encodeColor(texels, block, true);
+    }
+
+    //alpha block then a 4 color BC1 block
+    void encodeBC3(const unsigned char texels[64], unsigned char block[16])
+    {
+        int a0 = 0;
+        int a1 = 255;
+        for (int i = 0; i < 16; ++i)
+        {
+            int a = texels[i * 4 + 3];
+            a0 = a > a0 ? a : a0;
+            a1 = a < a1 ? a : a1;
+        }
+
+        //a0 > a1 selects the 8 value palette
+        int palette[8] = { a0, a1 };
+        for (int p = 1; p < 7; ++p)
+            palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+
+        unsigned long long indices = 0;
+        for (int i = 0; a0 != a1 && i < 16; ++i)
+        {
+            int a = texels[i * 4 + 3];
+            int best = 0;
+            int bestError = 1 << 30;
+            for (int p = 0; p < 8; ++p)
+            {
+                int error = (a - palette[p]) * (a - palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (unsigned long long)best << (3 * i);
+        }
+
+        block[0] = (unsigned char)a0;
+        block[1] = (unsigned char)a1;
+        for (int b = 0; b < 6; ++b)
+            block[2 + b] = (unsigned char)((indices >> (8 * b)) & 0xFF);
+
+        encodeColor(texels, block + 8, false);
+    }
+
+    //mode 6: one subset, rgba endpoints with 7 bits plus a p bit, 4 bit indices
+    void encodeBC7(const unsigned char texels[64], unsigned char block[16])
+    {
+        float low[4], high[4];
+        principalEndpoints(texels, 4, nullptr, low, high);
+
+        int e0[4], e1[4];
+        int p0 = 0, p1 = 0;
+        quantizeMode6(low, e0, p0);
+        quantizeMode6(high, e1, p1);
+
+        int palette[16][4];
+        for (int c = 0; c < 4; ++c)
+        {
+            int a = (e0[c] << 1) | p0;
+            int b = (e1[c] << 1) | p1;
+            for (int w = 0; w < 16; ++w)
+                palette[w][c] = ((64 - BC7_WEIGHTS4[w]) * a + BC7_WEIGHTS4[w] * b + 32) >> 6;
+        }
+
+        int indices[16];
+        for (int i = 0; i < 16; ++i)
+        {
+            int bestError = 1 << 30;
+            for (int w = 0; w < 16; ++w)
+            {
+                int error = squaredDistance(texels + i * 4, palette[w], 4);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    indices[i] = w;
+                }
+            }
+        }
+
+        //the first index has an implied 0 top bit, flip the endpoints if it is set
+        if (indices[0] & 8)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                int swap = e0[c];
+                e0[c] = e1[c];
+                e1[c] = swap;
+            }
+            int swap = p0;
+            p0 = p1;
+            p1 = swap;
+            for (int i = 0; i < 16; ++i)
+                indices[i] = 15 - indices[i];
+        }
+
+        memset(block, 0, 16);
+        bitWriter out = { block };
+        out.write(1 << 6, 7); //mode 6
+        for (int c = 0; c < 4; ++c)
+        {
+            out.write((unsigned int)e0[c], 7);
+            out.write((unsigned int)e1[c], 7);
+        }
+        out.write((unsigned int)p0, 1);
+        out.write((unsigned int)p1, 1);
+        out.write((unsigned int)indices[0], 3);
+        for (int i = 1; i < 16; ++i)
+            out.write((unsigned int)indices[i], 4);
+    }
+
+    void decodeBC1(const unsigned char block[8], unsigned char texels[64])
+    {
+        decodeColor(block, texels, true);
+    }
+
+    void decodeBC3(const unsigned char block[16], unsigned char texels[64])
+    {
+        decodeColor(block + 8, texels, false);
+
+        int a0 = block[0];
+        int a1 = block[1];
+        int palette[8] = { a0, a1 };
+        if (a0 > a1)
+        {
+            for (int p = 1; p < 7; ++p)
+                palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+        }
+        else
+        {
+            for (int p = 1; p < 5; ++p)
+                palette[p + 1] = ((5 - p) * a0 + p * a1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        unsigned long long indices = 0;
+        for (int b = 0; b < 6; ++b)
+            indices |= (unsigned long long)block[2 + b] << (8 * b);
+
+        for (int i = 0; i < 16; ++i)
+            texels[i * 4 + 3] = (unsigned char)palette[(indices >> (3 * i)) & 7];
+    }
+
+    void decodeBC7(const unsigned char block[16], unsigned char texels[64])
+    {
+        bitReader in = { block };
+        if (in.read(7) != (1 << 6))
+        {
+            //not a mode 6 block, show magenta instead of guessing
+            for (int i = 0; i < 16; ++i)
+            {
+                texels[i * 4 + 0] = 255;
+                texels[i * 4 + 1] = 0;
+                texels[i * 4 + 2] = 255;
+                texels[i * 4 + 3] = 255;
+            }
+            return;
+        }
+
+        int e0[4], e1[4];
+        for (int c = 0; c < 4; ++c)
+        {
+            e0[c] = (int)in.read(7);
+            e1[c] = (int)in.read(7);
+        }
+        int p0 = (int)in.read(1);
+        int p1 = (int)in.read(1);
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int w = BC7_WEIGHTS4[in.read(i == 0 ? 3 : 4)];
+            for (int c = 0; c < 4; ++c)
+            {
+                int a = (e0[c] << 1) | p0;
+                int b = (e1[c] << 1) | p1;
+                texels[i * 4 + c] = (unsigned char)(((64 - w) * a + w * b + 32) >> 6);
+            }
+        }
+    }
+
+    void encode(Format format, const unsigned char texels[64], unsigned char* block)
+    {
+        switch (format)
+        {
+        case BC1: encodeBC1(texels, block); break;
+        case BC3: encodeBC3(texels, block); break;
+        default:  encodeBC7(texels, block); break;
+        }
+    }
+
+    void decode(Format format, const unsigned char* block, unsigned char texels[64])
+    {
+        switch (format)
+        {
+        case BC1: decodeBC1(block, texels); break;
+        case BC3: decodeBC3(block, texels); break;
+        default:  decodeBC7(block, texels); break;
+        }
+    }
+}
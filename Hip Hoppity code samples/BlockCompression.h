@@ -0,0 +1,37 @@
+/*
+ * file: BlockCompression.h
+ * author: Mark Kouris
+ * brief: CPU encoders and decoders for the block compressed texture formats.
+ *        Every function works on one 4x4 block of RGBA8 texels, 64 bytes in
+ *        row order, and writes or reads the compressed block.
+ *
+ */
+#pragma once
+
+namespace BlockCompression
+{
+    enum Format
+    {
+        BC1 = 1, // 8 bytes per block, RGB with 1 bit alpha
+        BC3 = 3, // 16 bytes per block, RGB plus interpolated alpha
+        BC7 = 7  // 16 bytes per block, RGBA, only mode 6 is written
+    };
+
+    //8 for BC1, 16 for BC3 and BC7
+    unsigned int blockBytes(Format format);
+
+    //the GL internal format glCompressedTexImage2D expects for this format
+    unsigned int glFormat(Format format);
+
+    void encodeBC1(const unsigned char texels[64], unsigned char block[8]);
+    void encodeBC3(const unsigned char texels[64], unsigned char block[16]);
+    void encodeBC7(const unsigned char texels[64], unsigned char block[16]);
+
+    void decodeBC1(const unsigned char block[8], unsigned char texels[64]);
+    void decodeBC3(const unsigned char block[16], unsigned char texels[64]);
+    void decodeBC7(const unsigned char block[16], unsigned char texels[64]); //mode 6 blocks only
+
+    //helpers that pick the encoder/decoder for a format
+    void encode(Format format, const unsigned char texels[64], unsigned char* block);
+    void decode(Format format, const unsigned char* block, unsigned char texels[64]);
+}
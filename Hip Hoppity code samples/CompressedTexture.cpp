@@ -0,0 +1,128 @@
+/*
+ * file: CompressedTexture.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the CompressedTexture class,
+ *        this uploads baked block compressed textures.
+ */
+
+#include "CompressedTexture.h"
+#include "BlockCompression.h"
+#include "GLState.h"
+#include <glad/glad.h>
+#include <cstring>   // memcmp, memcpy
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+//creates a GL texture from a baked file, returns 0 on failure
+unsigned int CompressedTexture::load(const char* path, unsigned int* bytes)
+{
+    std::vector<unsigned char> file;
+    if (!read(path, file))
+        return 0;
+
+    return create(file, path, bytes);
+}
+
+//reads the whole file and checks the header, no GL calls
+bool CompressedTexture::read(const char* path, std::vector<unsigned char>& file)
+{
+    std::ifstream inFile(path, std::ifstream::in | std::ifstream::binary | std::ifstream::ate);
+    if (!inFile.is_open())
+    {
+        std::cout << "ERROR::COMPRESSED_TEXTURE::COULD_NOT_OPEN " << path << std::endl;
+        return false;
+    }
+
+    file.resize((size_t)inFile.tellg());
+    inFile.seekg(0);
+    inFile.read((char*)file.data(), (std::streamsize)file.size());
+
+    CompressedTextureHeader header;
+    if (!inFile || file.size() < sizeof(header))
+    {
+        std::cout << "ERROR::COMPRESSED_TEXTURE::BAD_HEADER " << path << std::endl;
+        return false;
+    }
+
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, "HHCT", 4) != 0 || header.version != COMPRESSED_TEXTURE_VERSION)
+    {
+        std::cout << "ERROR::COMPRESSED_TEXTURE::BAD_HEADER " << path << std::endl;
+        return false;
+    }
+
+    if (!isSupported(header.format))
+    {
+        std::cout << "ERROR::COMPRESSED_TEXTURE::FORMAT_NOT_SUPPORTED BC" << header.format << " " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+//makes the texture from a file read() accepted, GL thread only
+unsigned int CompressedTexture::create(const std::vector<unsigned char>& file, const char* path, unsigned int* bytes)
+{
+    CompressedTextureHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+
+    BlockCompression::Format format = (BlockCompression::Format)header.format;
+    unsigned int texture = 0;
+    unsigned int total = 0;
+    size_t offset = sizeof(header);
+
+    glGenTextures(1, &texture);
+    GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, header.mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (int)header.mipCount - 1);
+
+    for (unsigned int level = 0; level < header.mipCount; ++level)
+    {
+        CompressedMipHeader mip;
+        bool truncated = file.size() - offset < sizeof(mip);
+        if (!truncated)
+        {
+            memcpy(&mip, file.data() + offset, sizeof(mip));
+            offset += sizeof(mip);
+            truncated = file.size() - offset < mip.byteSize;
+        }
+
+        if (truncated)
+        {
+            std::cout << "ERROR::COMPRESSED_TEXTURE::TRUNCATED " << path << std::endl;
+            glDeleteTextures(1, &texture);
+            GLState::forgetTexture(texture);
+            return 0;
+        }
+
+        //no decoding on our side, the blocks go to the driver as they are
+        glCompressedTexImage2D(GL_TEXTURE_2D, (int)level, BlockCompression::glFormat(format),
+            (int)mip.width, (int)mip.height, 0, (int)mip.byteSize, file.data() + offset);
+        offset += mip.byteSize;
+        total += mip.byteSize;
+    }
+
+    if (bytes)
+        *bytes = total;
+
+    return texture;
+}
+
+//BC1 and BC3 come from S3TC, BC7 from BPTC which is core in 4.2
+bool CompressedTexture::isSupported(unsigned int format)
+{
+    switch (format)
+    {
+    case BlockCompression::BC1:
+    case BlockCompression::BC3:
+        return GLAD_GL_EXT_texture_compression_s3tc != 0;
+    case BlockCompression::BC7:
+        return GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_compression_bptc;
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * file: CompressedTexture.h
+ * author: Mark Kouris
+ * brief: the interface of the CompressedTexture class and its file layout.
+ *        Files are written by the TextureBaker tool and hold block compressed
+ *        mip levels that are handed to glCompressedTexImage2D as they are.
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* File layout:
+
+    CompressedTextureHeader
+    for each mip level, largest first:
+        CompressedMipHeader
+        byteSize bytes of blocks, rows of 4x4 blocks from the bottom up
+
+*/
+
+struct CompressedTextureHeader
+{
+    char magic[4];      // "HHCT"
+    uint32_t version;   // COMPRESSED_TEXTURE_VERSION
+    uint32_t format;    // a BlockCompression::Format
+    uint32_t width;     // size of mip 0 in texels
+    uint32_t height;
+    uint32_t mipCount;  // how many levels follow
+};
+
+struct CompressedMipHeader
+{
+    uint32_t width;     // size of this level in texels
+    uint32_t height;
+    uint32_t byteSize;  // bytes of block data after this header
+};
+
+#define COMPRESSED_TEXTURE_VERSION 1
+
+class CompressedTexture
+{
+public:
+    //creates a GL texture from a baked file, returns 0 on failure.
+    //bytes is set to the VRAM the levels take when given
+    static unsigned int load(const char* path, unsigned int* bytes = nullptr);
+
+    //the two halves of load. read makes no GL calls so workers can run it, it reads the
+    //whole file and checks its header. create makes the texture on the GL thread
+    static bool read(const char* path, std::vector<unsigned char>& file);
+    static unsigned int create(const std::vector<unsigned char>& file, const char* path,
+        unsigned int* bytes = nullptr);
+
+    //whether the driver can take this BlockCompression::Format
+    static bool isSupported(unsigned int format);
+
+    //the file TextureBaker writes for an image, Run_0.png becomes Run_0.hct and a name
+    //without an extension gets one added. Defined here so the baker needs no GL
+    static std::string bakedPath(const std::string& path)
+    {
+        size_t dot = path.find_last_of('.');
+        size_t slash = path.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            return path + ".hct";
+        return path.substr(0, dot) + ".hct";
+    }
+};
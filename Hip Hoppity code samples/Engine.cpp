@@ -11,10 +11,14 @@
 #include "Engine.h" 
 #include "Log.h"
 #include "SystemManager.h"
+#include "GLState.h"
+#include "ProgramCache.h"
+#include <GLFW/glfw3.h>
 
 #include "imgui.h"
 #include "backends/imgui_impl_opengl3.h"        // imgui backend opengl3 file
 #include "backends/imgui_impl_glfw.h"           // imgui backend glfw file
+#include <iostream>
 #include <vector>
 #include <string>
 
@@ -36,14 +40,70 @@ void CloseWindow(const ShutDown* event);    // declaration
 //default dtor
 Engine::~Engine()
 {
+    //systems go first, their animations still hold cache handles and draw streamed textures
     SysManager::DestroySystems();
+
+    //the streamer waits on its uploads, then the upload thread lets go of
+    //its context before the window under it goes away
+    textureCache.reset();
+    textureStreamer.reset();
+    uploadService.reset();
+    if (uploadWindow)
+        glfwDestroyWindow(uploadWindow);
 }
 
 // Initialize all systems in the engine.
 void Engine::Initialize()
 {
     EventManager::AddEventReceiver<ShutDown>("Shutdown", CloseWindow);
+
+    //every Mesh and Shader lives in these pools, so they exist before anything builds one
+    resources = std::make_unique<Resources>();
+    spriteBatch = std::make_unique<SpriteBatch>();
+    geometryArena = std::make_unique<GeometryArena>();
+
+    //a hidden window whose context shares objects with the main one, asking for the same version
+    int major = 0, minor = 0, profile = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    glGetIntegerv(GL_CONTEXT_PROFILE_MASK, &profile);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+    if (profile & GL_CONTEXT_CORE_PROFILE_BIT)
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    uploadWindow = glfwCreateWindow(1, 1, "uploads", nullptr, glfwGetCurrentContext());
+    glfwDefaultWindowHints();
+
+    GLFWwindow* window = uploadWindow;
+    uploadService = std::make_unique<UploadService>(
+        [window] { glfwMakeContextCurrent(window); return window != nullptr; },
+        [] { glfwMakeContextCurrent(nullptr); });
+    textureStreamer = std::make_unique<TextureStreamer>(*uploadService);
+    textureCache = std::make_unique<TextureCache>(*textureStreamer, 256 * 1024 * 1024);
+    sharedUniforms = std::make_unique<SharedUniforms>();
+    shaderLibrary = std::make_unique<ShaderLibrary>();
+
+    //its quad comes from the MeshRegistry, so this waits for Resources and the upload service
+    if (spriteInstancing)
+    {
+        spriteInstancer = std::make_unique<SpriteInstancer>();
+        if (!spriteInstancer->isSupported())
+            spriteInstancer.reset();
+    }
+
     for (System* sys : SysManager::systems_) sys->Init();
+
+    //systems add their shaders in Init, the driver has been compiling them since
+    shaderLibrary->sync();
+
+#ifdef _DEBUG
+    //this is the startup cost, time spent waiting in sync() is counted per shader.
+    //the Shader Cache window keeps showing the same numbers afterwards
+    const ProgramCache::Stats& shaderStats = ProgramCache::getStats();
+    std::cout << "SHADERS::STARTUP " << shaderStats.hits << " from cache in " << shaderStats.hitMilliseconds
+              << " ms, " << shaderStats.misses << " compiled in " << shaderStats.missMilliseconds << " ms" << std::endl;
+#endif
 }
 
 // Update all systems in the engine.
@@ -52,6 +112,13 @@ void Engine::Update(float dt)
     std::vector<float> times;
     std::vector<std::string> names;
 
+    //replays ignore the real frame time so runs are repeatable
+    if (replayFrames > 0)
+        dt = replayDt;
+
+    frameDt = dt;
+    elapsedTime += dt;
+
     for (System* sys : SysManager::systems_)
     {
         previous = timer.now();
@@ -60,6 +127,16 @@ void Engine::Update(float dt)
         times.push_back(std::chrono::duration_cast<std::chrono::duration<float, std::milli>>(now - previous).count());
         names.push_back(sys->Name());
     }
+
+    if (telemetry)
+    {
+        for (size_t i = 0; i < times.size(); ++i)
+            telemetry->record(names[i], times[i]);
+        telemetry->endFrame();
+
+        if (replayFrames > 0 && --replayFrames == 0)
+            StopRunning();
+    }
 #ifdef _DEBUG
     ImGui::Begin("System Times");
 
@@ -74,7 +151,68 @@ void Engine::Update(float dt)
 // Render all systems in the engine.
 void Engine::Render()
 {
+    //ImGui drew with raw GL since our last frame
+    GLState::invalidate();
+    GLState::beginFrame();
+
+    //uploads from the upload thread that finished since last frame become usable
+    uploadService->poll();
+
+    //finish some of the background texture loads before anything draws
+    textureStreamer->pump(uploadBudget);
+
+    //shared blocks go up once here instead of once per shader
+    sharedUniforms->setFrame(elapsedTime, frameDt, resolution);
+    sharedUniforms->upload();
+
+    if (spriteInstancer)
+        spriteInstancer->beginFrame();
+
     for (System* sys : SysManager::systems_) sys->Render();
+
+    //everything submitted by the systems is drawn sorted, then in a few large calls
+    renderQueue.execute();
+    geometryArena->execute();
+    spriteBatch->flush();
+    if (spriteInstancer)
+        spriteInstancer->endFrame();
+    textureCache->endFrame();
+
+    //nothing drawn this frame can still need what was released during it
+    resources->collect();
+#ifdef _DEBUG
+    ImGui::Begin("Sprite Batch");
+    ImGui::Text("sprites %u, culled %u, draw calls %u", spriteBatch->getSpriteCount(),
+        spriteBatch->getCulledCount(), spriteBatch->getDrawCalls());
+    if (spriteInstancer)
+        ImGui::Text("instanced %u, draw calls %u, stalls %u", spriteInstancer->getInstanceCount(),
+            spriteInstancer->getDrawCalls(), spriteInstancer->getStallCount());
+    ImGui::End();
+
+    const RenderQueue::Stats& queueStats = renderQueue.getStats();
+    ImGui::Begin("Render Queue");
+    ImGui::Text("draws %u", queueStats.draws);
+    ImGui::Text("programs %u (unsorted %u)", queueStats.programChanges, queueStats.submittedProgramChanges);
+    ImGui::Text("meshes %u (unsorted %u)", queueStats.meshChanges, queueStats.submittedMeshChanges);
+    ImGui::Text("textures %u (unsorted %u)", queueStats.textureChanges, queueStats.submittedTextureChanges);
+    ImGui::End();
+
+    ImGui::Begin("GL State");
+    ImGui::Text("issued %u, filtered %u", GLState::getLastFrame().issued, GLState::getLastFrame().filtered);
+    ImGui::End();
+
+    TextureCache::Stats cacheStats = textureCache->getStats();
+    ImGui::Begin("Texture Cache");
+    ImGui::Text("resident %.1f / %.1f MB", cacheStats.residentBytes / 1048576.0, cacheStats.budgetBytes / 1048576.0);
+    ImGui::Text("hit rate %.3f, evictions %llu", cacheStats.hitRate(), cacheStats.evictions);
+    ImGui::End();
+
+    const ProgramCache::Stats& shaderStats = ProgramCache::getStats();
+    ImGui::Begin("Shader Cache");
+    ImGui::Text("binaries %u in %.2f ms", shaderStats.hits, shaderStats.hitMilliseconds);
+    ImGui::Text("compiled %u in %.2f ms, rejected %u", shaderStats.misses, shaderStats.missMilliseconds, shaderStats.rejected);
+    ImGui::End();
+#endif
 }
 
 // For while loop in main 
@@ -88,6 +226,80 @@ void Engine::StopRunning()
     isRunning = false;
 }
 
+SpriteBatch& Engine::GetSpriteBatch()
+{
+    return *spriteBatch;
+}
+
+RenderQueue& Engine::GetRenderQueue()
+{
+    return renderQueue;
+}
+
+void Engine::EnableSpriteInstancing()
+{
+    spriteInstancing = true;
+}
+
+SpriteInstancer* Engine::GetSpriteInstancer()
+{
+    return spriteInstancer.get();
+}
+
+GeometryArena& Engine::GetGeometryArena()
+{
+    return *geometryArena;
+}
+
+TextureStreamer& Engine::GetTextureStreamer()
+{
+    return *textureStreamer;
+}
+
+void Engine::SetUploadBudget(float milliseconds)
+{
+    uploadBudget = milliseconds;
+}
+
+UploadService& Engine::GetUploadService()
+{
+    return *uploadService;
+}
+
+TextureCache& Engine::GetTextureCache()
+{
+    return *textureCache;
+}
+
+ShaderLibrary& Engine::GetShaderLibrary()
+{
+    return *shaderLibrary;
+}
+
+SharedUniforms& Engine::GetSharedUniforms()
+{
+    return *sharedUniforms;
+}
+
+Resources& Engine::GetResources()
+{
+    return *resources;
+}
+
+void Engine::SetResolution(int width, int height)
+{
+    resolution = glm::vec2((float)width, (float)height);
+}
+
+// opt-in telemetry, see Engine.h
+void Engine::EnableTelemetry(const char* outputPath, Telemetry::Format format,
+    unsigned int windowFrames, unsigned int replayFrames, float replayDt)
+{
+    telemetry = std::make_unique<Telemetry>(outputPath, format, windowFrames);
+    this->replayFrames = replayFrames;
+    this->replayDt = replayDt;
+}
+
 void Engine::OnEvent(const ShutDown* event)
 {
     SysManager::GetEngine()->StopRunning();
@@ -14,9 +14,22 @@
 //#include "framework.h"
 
 #include <chrono>
+#include <memory>   //std::unique_ptr
+#include "Telemetry.h"
+#include "SpriteBatch.h"
+#include "SpriteInstancer.h"
+#include "RenderQueue.h"
+#include "GeometryArena.h"
+#include "TextureStreamer.h"
+#include "TextureCache.h"
+#include "SharedUniforms.h"
+#include "ShaderLibrary.h"
+#include "Resources.h"
+#include "UploadService.h"
 
 class Event;
 class ShutDown;
+struct GLFWwindow;
 
 class Engine
 {
@@ -44,6 +57,48 @@ public:
 	void StopRunning();
 
 	void OnEvent(const ShutDown*);
+
+	// sprites are submitted here during Render and drawn together afterwards
+	SpriteBatch& GetSpriteBatch();
+
+	// opt-in, call before Initialize. Sprites reserved on the instancer during Render are
+	// drawn after the SpriteBatch. Null when not enabled or the driver lacks buffer storage
+	// or base instance, systems then submit to the SpriteBatch
+	void EnableSpriteInstancing();
+	SpriteInstancer* GetSpriteInstancer();
+
+	// mesh draws are submitted here during Render and drawn sorted by state afterwards
+	RenderQueue& GetRenderQueue();
+
+	// meshes packed into shared buffers, drawn with one multi draw per shader and texture
+	GeometryArena& GetGeometryArena();
+
+	// background texture loading, uploads are spent from a per frame budget
+	TextureStreamer& GetTextureStreamer();
+	void SetUploadBudget(float milliseconds);
+
+	// buffer and texture uploads from any thread, issued on a second shared context
+	UploadService& GetUploadService();
+
+	// streamed textures are kept under this many bytes, least recently drawn go first
+	TextureCache& GetTextureCache();
+
+	// shaders added during Init compile together and are checked once every system is initialized
+	ShaderLibrary& GetShaderLibrary();
+
+	// per frame and per camera uniform blocks, cameras call setCamera before Render
+	SharedUniforms& GetSharedUniforms();
+	void SetResolution(int width, int height); // framebuffer size, call on resize
+
+	// handle pools for meshes, shaders and textures, releases are destroyed at the end of Render.
+	// Mesh and Shader are handles into these, made first in Initialize and gone after ~Engine
+	Resources& GetResources();
+
+	// opt-in, records system times and writes a report on shutdown.
+	// replayFrames > 0 runs that many frames with replayDt then stops,
+	// so two runs can be compared with TelemetryCompare.
+	void EnableTelemetry(const char* outputPath, Telemetry::Format format = Telemetry::CSV,
+		unsigned int windowFrames = 600, unsigned int replayFrames = 0, float replayDt = 1.f / 60.f);
 private:
 
 	// private variables
@@ -51,4 +106,24 @@ private:
 
 	std::chrono::high_resolution_clock timer;
 	std::chrono::steady_clock::time_point previous, now;
+
+	std::unique_ptr<Resources> resources; // made in Initialize, once GL is ready. Declared first so it goes last
+	std::unique_ptr<SpriteBatch> spriteBatch; // made in Initialize, once GL is ready
+	bool spriteInstancing = false;        // set by EnableSpriteInstancing, read in Initialize
+	std::unique_ptr<SpriteInstancer> spriteInstancer; // null unless enabled and supported
+	RenderQueue renderQueue;              // sorted mesh draws, no GL until execute
+	std::unique_ptr<GeometryArena> geometryArena; // made in Initialize, once GL is ready
+	std::unique_ptr<TextureStreamer> textureStreamer; // made in Initialize, once GL is ready
+	float uploadBudget = 2.f;             // ms per frame spent uploading streamed textures
+	std::unique_ptr<TextureCache> textureCache; // evicts from textureStreamer, default 256MB
+	GLFWwindow* uploadWindow = nullptr;    // hidden, only there for the upload context
+	std::unique_ptr<UploadService> uploadService; // made in Initialize, once GL is ready
+	std::unique_ptr<ShaderLibrary> shaderLibrary; // made in Initialize, once GL is ready
+	std::unique_ptr<SharedUniforms> sharedUniforms; // made in Initialize, once GL is ready
+	float elapsedTime = 0.f;              // seconds since Initialize, FrameData.time
+	float frameDt = 0.f;                  // dt of the last Update, FrameData.deltaTime
+	glm::vec2 resolution = glm::vec2(0);  // framebuffer size, FrameData.resolution
+	std::unique_ptr<Telemetry> telemetry; // null unless EnableTelemetry was called
+	unsigned int replayFrames = 0;        // frames left in a fixed replay, 0 when not replaying
+	float replayDt = 0.f;                 // dt used for every replayed frame
 };
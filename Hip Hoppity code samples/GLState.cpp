@@ -0,0 +1,243 @@
+/*
+ * file: GLState.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the GLState class,
+ *        this filters redundant GL state changes.
+ */
+
+#include "GLState.h"
+
+/* Use Notes:
+
+Everything starts as UNKNOWN, so the first call of each kind always goes
+through. The element array binding belongs to the VAO, so it is forgotten
+whenever the VAO changes. Targets without a slot are never filtered, they
+are still counted as issued.
+
+Anything that calls GL binding functions directly leaves the cache stale,
+so code outside the engine (ImGui, middleware) must be followed by
+invalidate(). Engine::Render invalidates once at the start of every frame.
+
+*/
+
+unsigned int GLState::program_ = GLState::UNKNOWN;
+unsigned int GLState::vertexArray_ = GLState::UNKNOWN;
+unsigned int GLState::buffers_[GLState::BUFFER_SLOTS] = { GLState::UNKNOWN, GLState::UNKNOWN,
+    GLState::UNKNOWN, GLState::UNKNOWN, GLState::UNKNOWN };
+unsigned int GLState::activeUnit_ = GLState::UNKNOWN;
+unsigned int GLState::textures_[GLState::TEXTURE_UNITS] = {};  //target GL_NONE never matches a bind
+GLenum GLState::textureTargets_[GLState::TEXTURE_UNITS] = {};
+unsigned int GLState::blend_ = GLState::UNKNOWN;
+unsigned int GLState::blendSource_ = GLState::UNKNOWN;
+unsigned int GLState::blendDestination_ = GLState::UNKNOWN;
+unsigned int GLState::depthTest_ = GLState::UNKNOWN;
+unsigned int GLState::depthMask_ = GLState::UNKNOWN;
+GLState::Counters GLState::thisFrame_;
+GLState::Counters GLState::lastFrame_;
+
+void GLState::useProgram(unsigned int program)
+{
+    if (changed(program_, program))
+        glUseProgram(program);
+}
+
+void GLState::bindVertexArray(unsigned int VAO)
+{
+    if (changed(vertexArray_, VAO))
+    {
+        glBindVertexArray(VAO);
+        buffers_[ELEMENT_ARRAY] = UNKNOWN;
+    }
+}
+
+void GLState::bindBuffer(GLenum target, unsigned int buffer)
+{
+    int slot = slotOf(target);
+    if (slot < 0)
+    {
+        ++thisFrame_.issued;
+        glBindBuffer(target, buffer);
+        return;
+    }
+
+    if (changed(buffers_[slot], buffer))
+        glBindBuffer(target, buffer);
+}
+
+//indexed bindings are not cached, but GL also binds the buffer to the generic target
+void GLState::bindBufferBase(GLenum target, unsigned int index, unsigned int buffer)
+{
+    ++thisFrame_.issued;
+    glBindBufferBase(target, index, buffer);
+
+    int slot = slotOf(target);
+    if (slot >= 0)
+        buffers_[slot] = buffer;
+}
+
+void GLState::bindTexture(unsigned int unit, GLenum target, unsigned int texture)
+{
+    if (unit >= TEXTURE_UNITS)
+    {
+        thisFrame_.issued += 2;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        activeUnit_ = unit;
+        return;
+    }
+
+    //the unit is selected even when the bind is filtered, callers follow up
+    //with glTexParameteri/glTexSubImage2D and those act on the active unit
+    if (changed(activeUnit_, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+
+    if (textures_[unit] == texture && textureTargets_[unit] == target)
+    {
+        ++thisFrame_.filtered;
+        return;
+    }
+
+    ++thisFrame_.issued;
+    glBindTexture(target, texture);
+    textures_[unit] = texture;
+    textureTargets_[unit] = target;
+}
+
+void GLState::setBlend(bool enabled)
+{
+    if (changed(blend_, enabled ? 1 : 0))
+    {
+        if (enabled)
+            glEnable(GL_BLEND);
+        else
+            glDisable(GL_BLEND);
+    }
+}
+
+void GLState::setBlendFunc(GLenum source, GLenum destination)
+{
+    if (blendSource_ == source && blendDestination_ == destination)
+    {
+        ++thisFrame_.filtered;
+        return;
+    }
+
+    ++thisFrame_.issued;
+    glBlendFunc(source, destination);
+    blendSource_ = source;
+    blendDestination_ = destination;
+}
+
+void GLState::setDepthTest(bool enabled)
+{
+    if (changed(depthTest_, enabled ? 1 : 0))
+    {
+        if (enabled)
+            glEnable(GL_DEPTH_TEST);
+        else
+            glDisable(GL_DEPTH_TEST);
+    }
+}
+
+void GLState::setDepthMask(bool enabled)
+{
+    if (changed(depthMask_, enabled ? 1 : 0))
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void GLState::forgetProgram(unsigned int program)
+{
+    if (program_ == program)
+        program_ = UNKNOWN;
+}
+
+void GLState::forgetVertexArray(unsigned int VAO)
+{
+    if (vertexArray_ == VAO)
+    {
+        vertexArray_ = UNKNOWN;
+        buffers_[ELEMENT_ARRAY] = UNKNOWN;
+    }
+}
+
+void GLState::forgetBuffer(unsigned int buffer)
+{
+    for (unsigned int& bound : buffers_)
+    {
+        if (bound == buffer)
+            bound = UNKNOWN;
+    }
+}
+
+void GLState::forgetTexture(unsigned int texture)
+{
+    for (unsigned int& bound : textures_)
+    {
+        if (bound == texture)
+            bound = UNKNOWN;
+    }
+}
+
+void GLState::invalidate()
+{
+    program_ = UNKNOWN;
+    vertexArray_ = UNKNOWN;
+    activeUnit_ = UNKNOWN;
+    blend_ = UNKNOWN;
+    blendSource_ = UNKNOWN;
+    blendDestination_ = UNKNOWN;
+    depthTest_ = UNKNOWN;
+    depthMask_ = UNKNOWN;
+
+    for (unsigned int& bound : buffers_)
+        bound = UNKNOWN;
+
+    for (unsigned int unit = 0; unit < TEXTURE_UNITS; ++unit)
+    {
+        textures_[unit] = UNKNOWN;
+        textureTargets_[unit] = GL_NONE;
+    }
+}
+
+void GLState::beginFrame()
+{
+    lastFrame_ = thisFrame_;
+    thisFrame_ = Counters();
+}
+
+const GLState::Counters& GLState::getLastFrame()
+{
+    return lastFrame_;
+}
+
+const GLState::Counters& GLState::getThisFrame()
+{
+    return thisFrame_;
+}
+
+int GLState::slotOf(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:         return ARRAY;
+    case GL_ELEMENT_ARRAY_BUFFER: return ELEMENT_ARRAY;
+    case GL_PIXEL_UNPACK_BUFFER:  return PIXEL_UNPACK;
+    case GL_UNIFORM_BUFFER:       return UNIFORM;
+    case GL_DRAW_INDIRECT_BUFFER: return DRAW_INDIRECT;
+    default:                      return -1;
+    }
+}
+
+//updates the cached value and counts the call, true when GL has to be called
+bool GLState::changed(unsigned int& cached, unsigned int value)
+{
+    if (cached == value)
+    {
+        ++thisFrame_.filtered;
+        return false;
+    }
+
+    ++thisFrame_.issued;
+    cached = value;
+    return true;
+}
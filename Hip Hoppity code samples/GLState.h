@@ -0,0 +1,72 @@
+/*
+ * file: GLState.h
+ * author: Mark Kouris
+ * brief: the interface of the GLState class.
+ *        Thin layer every engine GL state change goes through. It remembers
+ *        what is bound and skips calls that would not change anything, and
+ *        counts issued against filtered calls so driver overhead can be seen.
+ *
+ */
+#pragma once
+#include <glad/glad.h>
+
+class GLState
+{
+public:
+    struct Counters
+    {
+        unsigned int issued = 0;   // calls that reached GL
+        unsigned int filtered = 0; // calls skipped because nothing changed
+    };
+
+    //binding
+    static void useProgram(unsigned int program);
+    static void bindVertexArray(unsigned int VAO);
+    static void bindBuffer(GLenum target, unsigned int buffer);
+    static void bindBufferBase(GLenum target, unsigned int index, unsigned int buffer); //also moves the generic binding
+    static void bindTexture(unsigned int unit, GLenum target, unsigned int texture); //leaves unit active
+
+    //fixed function state
+    static void setBlend(bool enabled);
+    static void setBlendFunc(GLenum source, GLenum destination);
+    static void setDepthTest(bool enabled);
+    static void setDepthMask(bool enabled);
+
+    //call right after deleting an object, GL unbinds deleted objects on its own.
+    //also after another context changed one, so the next bind is issued again
+    static void forgetProgram(unsigned int program);
+    static void forgetVertexArray(unsigned int VAO);
+    static void forgetBuffer(unsigned int buffer);
+    static void forgetTexture(unsigned int texture);
+
+    //drops everything remembered, call after code that uses GL directly (ImGui)
+    static void invalidate();
+
+    //moves this frame's counters to getLastFrame() and starts over
+    static void beginFrame();
+    static const Counters& getLastFrame();
+    static const Counters& getThisFrame();
+
+private:
+    static const unsigned int UNKNOWN = 0xFFFFFFFF;
+    static const unsigned int TEXTURE_UNITS = 16;
+
+    enum bufferSlot { ARRAY, ELEMENT_ARRAY, PIXEL_UNPACK, UNIFORM, DRAW_INDIRECT, BUFFER_SLOTS };
+    static int slotOf(GLenum target);
+
+    static bool changed(unsigned int& cached, unsigned int value);
+
+    static unsigned int program_;                        // current program
+    static unsigned int vertexArray_;                    // current VAO
+    static unsigned int buffers_[BUFFER_SLOTS];          // current buffer per cached target
+    static unsigned int activeUnit_;                     // current glActiveTexture unit
+    static unsigned int textures_[TEXTURE_UNITS];        // texture bound per unit
+    static GLenum textureTargets_[TEXTURE_UNITS];        // target of that texture
+    static unsigned int blend_;                          // 0, 1 or UNKNOWN
+    static unsigned int blendSource_;                    // current blend source factor
+    static unsigned int blendDestination_;               // current blend destination factor
+    static unsigned int depthTest_;                      // 0, 1 or UNKNOWN
+    static unsigned int depthMask_;                      // 0, 1 or UNKNOWN
+    static Counters thisFrame_;                          // counters being filled
+    static Counters lastFrame_;                          // counters of the finished frame
+};
@@ -0,0 +1,311 @@
+/*
+ * file: GeometryArena.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the GeometryArena class,
+ *        this suballocates shared buffers and draws with multi draw indirect.
+ */
+
+#include "GeometryArena.h"
+#include "GLState.h"
+#include <algorithm> // std::stable_sort, std::lower_bound
+#include <iostream>
+
+/* Use Notes:
+
+    GeometryArena::Range crate = arena.add(vertices, 24, indices, 36);
+    ...
+    arena.draw(shader, texture, crate, model); //every frame, from Render
+    ...
+    arena.execute();                           //once, after the systems render
+
+Every draw is one indirect command. Its baseInstance points at its model
+matrix, so shaders drawn through the arena read the same locations as the
+SpriteInstancer:
+    layout (location = 0) in vec3 aPos;
+    layout (location = 1) in vec3 aColor;
+    layout (location = 2) in vec2 aTexCoord;
+    layout (location = 3) in mat4 instanceModel;   // uses locations 3 to 6
+
+The command and matrix buffers are orphaned and refilled every frame, they
+are small next to the geometry (20 and 64 bytes a draw).
+
+*/
+
+//FREE LIST
+
+void GeometryArena::freeList::reset(unsigned int size)
+{
+    blocks_.clear();
+    blocks_.push_back({ 0, size });
+}
+
+bool GeometryArena::freeList::allocate(unsigned int size, unsigned int& offset)
+{
+    for (size_t i = 0; i < blocks_.size(); ++i)
+    {
+        block& b = blocks_[i];
+        if (b.size < size)
+            continue;
+
+        offset = b.offset;
+        b.offset += size;
+        b.size -= size;
+        if (b.size == 0)
+            blocks_.erase(blocks_.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+void GeometryArena::freeList::release(unsigned int offset, unsigned int size)
+{
+    //first block after the freed one
+    std::vector<block>::iterator next = std::lower_bound(blocks_.begin(), blocks_.end(), offset,
+        [](const block& b, unsigned int value) { return b.offset < value; });
+
+    bool joinsPrevious = next != blocks_.begin() && (next - 1)->offset + (next - 1)->size == offset;
+    bool joinsNext = next != blocks_.end() && offset + size == next->offset;
+
+    if (joinsPrevious && joinsNext)
+    {
+        (next - 1)->size += size + next->size;
+        blocks_.erase(next);
+    }
+    else if (joinsPrevious)
+        (next - 1)->size += size;
+    else if (joinsNext)
+    {
+        next->offset = offset;
+        next->size += size;
+    }
+    else
+        blocks_.insert(next, { offset, size });
+}
+
+unsigned int GeometryArena::freeList::blockCount() const
+{
+    return (unsigned int)blocks_.size();
+}
+
+//ARENA
+
+GeometryArena::GeometryArena(unsigned int maxVertices, unsigned int maxIndices, unsigned int maxDraws) :
+    maxVertices_(maxVertices), maxIndices_(maxIndices), maxDraws_(maxDraws)
+{
+    //each command's baseInstance picks its model matrix, without 4.2 it has to be 0
+    supported_ = (GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_multi_draw_indirect) &&
+                 (GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_base_instance);
+    if (!supported_)
+    {
+        std::cout << "GeometryArena: multi draw indirect or base instance not supported, use the RenderQueue" << std::endl;
+        return;
+    }
+
+    freeVertices_.reset(maxVertices_);
+    freeIndices_.reset(maxIndices_);
+    queue_.reserve(maxDraws_);
+    models_.reserve(maxDraws_);
+    sortedModels_.reserve(maxDraws_);
+    commands_.reserve(maxDraws_);
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &vertexBuffer);
+    glGenBuffers(1, &indexBuffer);
+    glGenBuffers(1, &modelBuffer);
+    glGenBuffers(1, &commandBuffer);
+
+    GLState::bindVertexArray(VAO);
+
+    GLState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)maxVertices_ * sizeof(Vertex), NULL, GL_STATIC_DRAW);
+
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)maxIndices_ * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+
+    //position, color and texture coordinate attributes, offsets and stride come from Vertex
+    VertexFormat::apply<Vertex>();
+
+    //model matrix takes 4 locations, one per column, stepped once per draw by baseInstance
+    GLState::bindBuffer(GL_ARRAY_BUFFER, modelBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)maxDraws_ * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+    for (unsigned int column = 0; column < 4; ++column)
+    {
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+            (void*)(column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(3 + column, 1);
+        glEnableVertexAttribArray(3 + column);
+    }
+
+    GLState::bindVertexArray(0);
+
+    GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)maxDraws_ * sizeof(indirectCommand), NULL, GL_STREAM_DRAW);
+}
+
+GeometryArena::~GeometryArena()
+{
+    if (!supported_)
+        return;
+
+    unsigned int buffers[] = { vertexBuffer, indexBuffer, modelBuffer, commandBuffer };
+    glDeleteBuffers(4, buffers);
+    for (unsigned int buffer : buffers)
+        GLState::forgetBuffer(buffer);
+
+    glDeleteVertexArrays(1, &VAO);
+    GLState::forgetVertexArray(VAO);
+}
+
+bool GeometryArena::isSupported() const
+{
+    return supported_;
+}
+
+//copies a mesh in, the range is invalid when either buffer is full
+GeometryArena::Range GeometryArena::add(const Vertex* vertices, unsigned int vertexCount,
+    const unsigned int* indices, unsigned int indexCount)
+{
+    Range range;
+    if (!supported_ || vertexCount == 0 || indexCount == 0)
+        return range;
+
+    if (!freeVertices_.allocate(vertexCount, range.firstVertex))
+    {
+        std::cout << "ERROR::GEOMETRY_ARENA::OUT_OF_VERTICES " << vertexCount << std::endl;
+        return Range();
+    }
+    if (!freeIndices_.allocate(indexCount, range.firstIndex))
+    {
+        freeVertices_.release(range.firstVertex, vertexCount);
+        std::cout << "ERROR::GEOMETRY_ARENA::OUT_OF_INDICES " << indexCount << std::endl;
+        return Range();
+    }
+
+    range.vertexCount = vertexCount;
+    range.indexCount = indexCount;
+    usedVertices_ += vertexCount;
+    usedIndices_ += indexCount;
+
+    GLState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)range.firstVertex * sizeof(Vertex),
+        (GLsizeiptr)vertexCount * sizeof(Vertex), vertices);
+
+    //the element binding belongs to the VAO, bind it there instead of disturbing another one
+    GLState::bindVertexArray(VAO);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)range.firstIndex * sizeof(unsigned int),
+        (GLsizeiptr)indexCount * sizeof(unsigned int), indices);
+    GLState::bindVertexArray(0);
+
+    return range;
+}
+
+//frees the range once this frame's execute() has drawn
+void GeometryArena::remove(const Range& range)
+{
+    if (range.isValid())
+        removed_.push_back(range);
+}
+
+//queues one draw for this frame, draws past maxDraws are dropped
+void GeometryArena::draw(const Shader& shader, unsigned int texture, const Range& range, const glm::mat4& model)
+{
+    if (!supported_ || !range.isValid() || queue_.size() >= maxDraws_)
+        return;
+
+    queued q;
+    q.key = ((unsigned long long)shader.getID() << 32) | texture;
+    q.shader = shader;
+    q.texture = texture;
+    q.range = range;
+    q.model = (unsigned int)models_.size();
+
+    queue_.push_back(q);
+    models_.push_back(model);
+}
+
+//builds and uploads the command buffer, then one multi draw per shader and texture
+void GeometryArena::execute()
+{
+    draws_ = 0;
+    multiDraws_ = 0;
+
+    if (!queue_.empty())
+    {
+        //stable so draws of one material keep their submit order
+        std::stable_sort(queue_.begin(), queue_.end(),
+            [](const queued& a, const queued& b) { return a.key < b.key; });
+
+        //commands and matrices both in sorted order, baseInstance is the command's own index
+        commands_.clear();
+        sortedModels_.clear();
+        for (const queued& q : queue_)
+        {
+            indirectCommand c;
+            c.count = q.range.indexCount;
+            c.instanceCount = 1;
+            c.firstIndex = q.range.firstIndex;
+            c.baseVertex = (int)q.range.firstVertex;
+            c.baseInstance = (unsigned int)commands_.size();
+            commands_.push_back(c);
+            sortedModels_.push_back(models_[q.model]);
+        }
+
+        //orphan then fill, the driver hands out fresh memory if last frame's is still in use
+        const GLsizeiptr modelBytes = (GLsizeiptr)sortedModels_.size() * sizeof(glm::mat4);
+        GLState::bindBuffer(GL_ARRAY_BUFFER, modelBuffer);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)maxDraws_ * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, modelBytes, sortedModels_.data());
+
+        const GLsizeiptr commandBytes = (GLsizeiptr)commands_.size() * sizeof(indirectCommand);
+        GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)maxDraws_ * sizeof(indirectCommand), NULL,
+            GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandBytes, commands_.data());
+
+        GLState::bindVertexArray(VAO);
+
+        //one multi draw for every run of equal shader and texture
+        size_t first = 0;
+        while (first < queue_.size())
+        {
+            size_t last = first + 1;
+            while (last < queue_.size() && queue_[last].key == queue_[first].key)
+                ++last;
+
+            queue_[first].shader.use();
+            GLState::bindTexture(0, GL_TEXTURE_2D, queue_[first].texture);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                (void*)(first * sizeof(indirectCommand)), (GLsizei)(last - first), 0);
+
+            ++multiDraws_;
+            first = last;
+        }
+
+        draws_ = (unsigned int)queue_.size();
+        GLState::bindVertexArray(0);
+    }
+
+    queue_.clear();
+    models_.clear();
+
+    //nothing queued can still point at these
+    for (const Range& range : removed_)
+    {
+        freeVertices_.release(range.firstVertex, range.vertexCount);
+        freeIndices_.release(range.firstIndex, range.indexCount);
+        usedVertices_ -= range.vertexCount;
+        usedIndices_ -= range.indexCount;
+    }
+    removed_.clear();
+}
+
+GeometryArena::Stats GeometryArena::getStats() const
+{
+    Stats stats;
+    stats.draws = draws_;
+    stats.multiDraws = multiDraws_;
+    stats.usedVertices = usedVertices_;
+    stats.usedIndices = usedIndices_;
+    stats.freeBlocks = freeVertices_.blockCount() + freeIndices_.blockCount();
+    return stats;
+}
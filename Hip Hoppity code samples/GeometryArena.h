@@ -0,0 +1,143 @@
+/*
+ * file: GeometryArena.h
+ * author: Mark Kouris
+ * brief: the interface of the GeometryArena class.
+ *        One large vertex buffer and one large index buffer shared by many
+ *        meshes, each mesh is only an offset and a count inside them. Draws
+ *        are gathered per shader and texture and each group goes out as one
+ *        glMultiDrawElementsIndirect, with the commands built every frame.
+ *
+ */
+#pragma once
+#include <glad/glad.h>
+#include "glm/glm/glm.hpp"
+#include <vector>
+#include "Shader.h"
+#include "VertexFormat.h"
+
+class GeometryArena
+{
+public:
+    //the one layout every mesh in the arena uses, same locations as Mesh, 20 bytes
+    struct Vertex
+    {
+        glm::vec3 position; //location 0
+        UNorm8x4 color;     //location 1
+        Half2 uv;           //location 2, halves so uvs can tile past 1
+
+        static constexpr std::array<VertexAttribute, 3> layout()
+        {
+            return {{ VERTEX_ATTRIBUTE(Vertex, position, 0),
+                      VERTEX_ATTRIBUTE(Vertex, color, 1),
+                      VERTEX_ATTRIBUTE(Vertex, uv, 2) }};
+        }
+    };
+
+    //where a mesh lives in the arena, indices are relative to firstVertex
+    struct Range
+    {
+        unsigned int firstVertex = 0;
+        unsigned int vertexCount = 0;
+        unsigned int firstIndex = 0;
+        unsigned int indexCount = 0;
+
+        bool isValid() const { return indexCount != 0; }
+    };
+
+    struct Stats
+    {
+        unsigned int draws = 0;          // meshes drawn last frame
+        unsigned int multiDraws = 0;     // glMultiDrawElementsIndirect calls last frame
+        unsigned int usedVertices = 0;   // allocated right now
+        unsigned int usedIndices = 0;    // allocated right now
+        unsigned int freeBlocks = 0;     // holes in both buffers, a fragmentation measure
+    };
+
+    GeometryArena(unsigned int maxVertices = 1 << 20, unsigned int maxIndices = 3 << 20,
+        unsigned int maxDraws = 16384);
+    ~GeometryArena();
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    //needs GL 4.3 multi draw indirect and 4.2 base instance, when false draw Meshes through the RenderQueue
+    bool isSupported() const;
+
+    //copies a mesh in, the range is invalid when either buffer is full
+    Range add(const Vertex* vertices, unsigned int vertexCount, const unsigned int* indices,
+        unsigned int indexCount);
+
+    //frees the range once this frame's execute() has drawn
+    void remove(const Range& range);
+
+    //queues one draw for this frame, draws past maxDraws are dropped
+    void draw(const Shader& shader, unsigned int texture, const Range& range, const glm::mat4& model);
+
+    //builds and uploads the command buffer, then one multi draw per shader and texture
+    void execute();
+
+    //gettors
+    Stats getStats() const;
+
+private:
+    //first fit over sorted free blocks, neighbours merge when a block is freed
+    class freeList
+    {
+    public:
+        void reset(unsigned int size);
+        bool allocate(unsigned int size, unsigned int& offset);
+        void release(unsigned int offset, unsigned int size);
+        unsigned int blockCount() const;
+
+    private:
+        struct block
+        {
+            unsigned int offset;
+            unsigned int size;
+        };
+        std::vector<block> blocks_; // sorted by offset, never touching
+    };
+
+    //laid out the way glMultiDrawElementsIndirect reads it
+    struct indirectCommand
+    {
+        unsigned int count;
+        unsigned int instanceCount;
+        unsigned int firstIndex;
+        int baseVertex;
+        unsigned int baseInstance; // picks this draw's model matrix
+    };
+
+    struct queued
+    {
+        unsigned long long key; // shader then texture, draws sort by it
+        Shader shader;          // a handle, copied in
+        unsigned int texture;
+        Range range;
+        unsigned int model;     // index into models_
+    };
+
+    unsigned int maxVertices_;
+    unsigned int maxIndices_;
+    unsigned int maxDraws_;
+    bool supported_ = false;
+
+    unsigned int VAO = 0;
+    unsigned int vertexBuffer = 0;
+    unsigned int indexBuffer = 0;
+    unsigned int modelBuffer = 0;    // one matrix per draw, read as an instance attribute
+    unsigned int commandBuffer = 0;  // GL_DRAW_INDIRECT_BUFFER
+
+    freeList freeVertices_;
+    freeList freeIndices_;
+    unsigned int usedVertices_ = 0;
+    unsigned int usedIndices_ = 0;
+
+    std::vector<queued> queue_;                 // this frame's draws
+    std::vector<glm::mat4> models_;             // this frame's matrices, in submit order
+    std::vector<glm::mat4> sortedModels_;       // the same, in command order
+    std::vector<indirectCommand> commands_;     // built in execute
+    std::vector<Range> removed_;                // freed after the next execute
+    unsigned int draws_ = 0;
+    unsigned int multiDraws_ = 0;
+};
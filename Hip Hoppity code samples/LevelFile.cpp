@@ -0,0 +1,481 @@
+/*
+ * file: LevelFile.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the LevelFile and LevelBuilder classes,
+ *        this maps level blobs and writes them.
+ */
+
+#include "LevelFile.h"
+#include <cstring>   // memcmp, memcpy
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Use Notes:
+
+    LevelFile level;
+    if (level.open("levels/stage1.hlv"))
+    {
+        for (uint32_t i = 0; i < level.getEntityCount(); ++i)
+        {
+            const LevelEntity& entity = level.getEntities()[i];
+            //entity.transform, level.getMeshes()[entity.mesh], entity.name.get() ...
+        }
+    }
+
+The mapping is copy on write, so the fix ups only copy the pages that hold
+pointers, the rest of the file is read straight from the page cache. Every
+pointer must land inside the string pool and the pool must end in a NUL, so
+a damaged file is rejected instead of handing out stray strings.
+
+Relocations have to be in increasing order and name every LevelPointer field
+of every record exactly once, sections may not overlap, and every index an
+entity holds has to be in range or NONE. Anything else is rejected before a
+single pointer is fixed up.
+
+*/
+
+//where the LevelPointers are inside each record, the builder writes these and validate expects them
+static const size_t entityPointers[] = { offsetof(LevelEntity, name) };
+static const size_t shaderPointers[] = { offsetof(LevelShader, vertexPath), offsetof(LevelShader, fragmentPath) };
+static const size_t texturePointers[] = { offsetof(LevelTexture, path) };
+static const size_t animationPointers[] = { offsetof(LevelAnimation, folderPath), offsetof(LevelAnimation, repeatedName) };
+
+//helper, next multiple of 16
+static uint32_t align16(size_t offset)
+{
+    return (uint32_t)((offset + 15) & ~(size_t)15);
+}
+
+//helper, whether offset is one of the pointer fields of a record in table
+static bool isPointerField(uint32_t offset, const LevelTable& table, size_t recordSize,
+    const size_t* pointerFields, size_t pointerCount)
+{
+    if (offset < table.offset || (uint64_t)offset >= table.offset + (uint64_t)table.count * recordSize)
+        return false;
+
+    const size_t inRecord = (offset - table.offset) % recordSize;
+    for (size_t p = 0; p < pointerCount; ++p)
+    {
+        if (inRecord == pointerFields[p])
+            return true;
+    }
+    return false;
+}
+
+//LEVEL FILE
+
+LevelFile::~LevelFile()
+{
+    close();
+}
+
+bool LevelFile::open(const char* path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        std::cout << "ERROR::LEVEL_FILE::COULD_NOT_OPEN " << path << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    HANDLE mapping = fileSize.QuadPart ? CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL) : NULL;
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : NULL;
+    if (!view)
+    {
+        std::cout << "ERROR::LEVEL_FILE::COULD_NOT_MAP " << path << std::endl;
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_ = file;
+    mapping_ = mapping;
+    data_ = (unsigned char*)view;
+    size_ = (size_t)fileSize.QuadPart;
+#else
+    int file = ::open(path, O_RDONLY);
+    if (file < 0)
+    {
+        std::cout << "ERROR::LEVEL_FILE::COULD_NOT_OPEN " << path << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    void* view = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+        view = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    ::close(file); //the mapping keeps the file alive on its own
+
+    if (view == MAP_FAILED)
+    {
+        std::cout << "ERROR::LEVEL_FILE::COULD_NOT_MAP " << path << std::endl;
+        return false;
+    }
+
+    data_ = (unsigned char*)view;
+    size_ = (size_t)info.st_size;
+#endif
+
+    if (!validate(path))
+    {
+        close();
+        return false;
+    }
+
+    //the only load time work, every pointer goes from offset to address
+    const LevelHeader& header = *(const LevelHeader*)data_;
+    const uint32_t* relocations = section<uint32_t>(header.relocations);
+    for (uint32_t i = 0; i < header.relocations.count; ++i)
+    {
+        uint64_t* pointer = (uint64_t*)(data_ + relocations[i]);
+        *pointer += (uint64_t)(uintptr_t)data_;
+    }
+
+    return true;
+}
+
+void LevelFile::close()
+{
+    if (!data_)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle((HANDLE)mapping_);
+    CloseHandle((HANDLE)file_);
+    mapping_ = nullptr;
+    file_ = nullptr;
+#else
+    munmap(data_, size_);
+#endif
+
+    data_ = nullptr;
+    size_ = 0;
+}
+
+//checks every offset before any of them is used
+bool LevelFile::validate(const char* path) const
+{
+    const LevelHeader* header = (const LevelHeader*)data_;
+    if (size_ < sizeof(LevelHeader) || memcmp(header->magic, "HHLV", 4) != 0 ||
+        header->version != LEVEL_FILE_VERSION)
+    {
+        std::cout << "ERROR::LEVEL_FILE::BAD_HEADER " << path << std::endl;
+        return false;
+    }
+    if (header->fileSize != size_)
+    {
+        std::cout << "ERROR::LEVEL_FILE::TRUNCATED " << path << std::endl;
+        return false;
+    }
+
+    //each table has to fit, sizes in 64 bits so a huge count cannot wrap
+    const LevelTable* tables[] = { &header->entities, &header->meshes, &header->shaders, &header->textures,
+        &header->animations, &header->strings, &header->relocations };
+    const size_t recordSizes[] = { sizeof(LevelEntity), sizeof(LevelMesh), sizeof(LevelShader),
+        sizeof(LevelTexture), sizeof(LevelAnimation), 1, sizeof(uint32_t) };
+    for (int i = 0; i < 7; ++i)
+    {
+        if (tables[i]->offset % 16 != 0 ||
+            (uint64_t)tables[i]->offset + (uint64_t)tables[i]->count * recordSizes[i] > size_)
+        {
+            std::cout << "ERROR::LEVEL_FILE::BAD_TABLE " << i << " " << path << std::endl;
+            return false;
+        }
+    }
+
+    //no section may share bytes with the header or another one, or a fix up could rewrite it
+    for (int i = 0; i < 7; ++i)
+    {
+        const uint64_t begin = tables[i]->offset;
+        const uint64_t end = begin + (uint64_t)tables[i]->count * recordSizes[i];
+        if (begin == end)
+            continue;
+
+        bool overlaps = begin < sizeof(LevelHeader);
+        for (int j = 0; j < i && !overlaps; ++j)
+        {
+            const uint64_t otherBegin = tables[j]->offset;
+            const uint64_t otherEnd = otherBegin + (uint64_t)tables[j]->count * recordSizes[j];
+            overlaps = otherBegin != otherEnd && begin < otherEnd && otherBegin < end;
+        }
+
+        if (overlaps)
+        {
+            std::cout << "ERROR::LEVEL_FILE::OVERLAPPING_TABLE " << i << " " << path << std::endl;
+            return false;
+        }
+    }
+
+    //records refer to each other by index, NONE is the only value allowed past the end
+    const LevelEntity* entities = section<LevelEntity>(header->entities);
+    for (uint32_t i = 0; i < header->entities.count; ++i)
+    {
+        const LevelEntity& entity = entities[i];
+        if ((entity.mesh >= header->meshes.count && entity.mesh != NONE) ||
+            (entity.shader >= header->shaders.count && entity.shader != NONE) ||
+            (entity.texture >= header->textures.count && entity.texture != NONE) ||
+            (entity.animation >= header->animations.count && entity.animation != NONE))
+        {
+            std::cout << "ERROR::LEVEL_FILE::BAD_INDEX entity " << i << " " << path << std::endl;
+            return false;
+        }
+    }
+
+    const uint64_t stringsBegin = header->strings.offset;
+    const uint64_t stringsEnd = stringsBegin + header->strings.count;
+    if (header->strings.count == 0 ? header->relocations.count != 0 : data_[stringsEnd - 1] != '\0')
+    {
+        std::cout << "ERROR::LEVEL_FILE::BAD_STRINGS " << path << std::endl;
+        return false;
+    }
+
+    //one relocation per pointer field, so increasing and all on fields means each is covered once
+    const uint64_t pointerCount = (uint64_t)header->entities.count + 2 * (uint64_t)header->shaders.count +
+        header->textures.count + 2 * (uint64_t)header->animations.count;
+    if (header->relocations.count != pointerCount)
+    {
+        std::cout << "ERROR::LEVEL_FILE::BAD_RELOCATIONS " << path << std::endl;
+        return false;
+    }
+
+    const uint32_t* relocations = section<uint32_t>(header->relocations);
+    for (uint32_t i = 0; i < header->relocations.count; ++i)
+    {
+        const uint32_t offset = relocations[i];
+        const bool field = isPointerField(offset, header->entities, sizeof(LevelEntity), entityPointers, 1) ||
+            isPointerField(offset, header->shaders, sizeof(LevelShader), shaderPointers, 2) ||
+            isPointerField(offset, header->textures, sizeof(LevelTexture), texturePointers, 1) ||
+            isPointerField(offset, header->animations, sizeof(LevelAnimation), animationPointers, 2);
+        if (!field || (i > 0 && offset <= relocations[i - 1]))
+        {
+            std::cout << "ERROR::LEVEL_FILE::BAD_RELOCATION " << i << " " << path << std::endl;
+            return false;
+        }
+
+        uint64_t target;
+        if (relocations[i] % 8 != 0 || (uint64_t)relocations[i] + sizeof(uint64_t) > size_)
+            target = 0;
+        else
+            memcpy(&target, data_ + relocations[i], sizeof(target));
+
+        if (target < stringsBegin || target >= stringsEnd)
+        {
+            std::cout << "ERROR::LEVEL_FILE::BAD_POINTER " << i << " " << path << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool LevelFile::isOpen() const
+{
+    return data_ != nullptr;
+}
+
+size_t LevelFile::byteSize() const
+{
+    return size_;
+}
+
+const LevelEntity* LevelFile::getEntities() const
+{
+    return section<LevelEntity>(((const LevelHeader*)data_)->entities);
+}
+
+uint32_t LevelFile::getEntityCount() const
+{
+    return data_ ? ((const LevelHeader*)data_)->entities.count : 0;
+}
+
+const LevelMesh* LevelFile::getMeshes() const
+{
+    return section<LevelMesh>(((const LevelHeader*)data_)->meshes);
+}
+
+uint32_t LevelFile::getMeshCount() const
+{
+    return data_ ? ((const LevelHeader*)data_)->meshes.count : 0;
+}
+
+const LevelShader* LevelFile::getShaders() const
+{
+    return section<LevelShader>(((const LevelHeader*)data_)->shaders);
+}
+
+uint32_t LevelFile::getShaderCount() const
+{
+    return data_ ? ((const LevelHeader*)data_)->shaders.count : 0;
+}
+
+const LevelTexture* LevelFile::getTextures() const
+{
+    return section<LevelTexture>(((const LevelHeader*)data_)->textures);
+}
+
+uint32_t LevelFile::getTextureCount() const
+{
+    return data_ ? ((const LevelHeader*)data_)->textures.count : 0;
+}
+
+const LevelAnimation* LevelFile::getAnimations() const
+{
+    return section<LevelAnimation>(((const LevelHeader*)data_)->animations);
+}
+
+uint32_t LevelFile::getAnimationCount() const
+{
+    return data_ ? ((const LevelHeader*)data_)->animations.count : 0;
+}
+
+//LEVEL BUILDER
+
+uint64_t LevelBuilder::intern(const char* text)
+{
+    std::unordered_map<std::string, uint64_t>::iterator found = interned_.find(text);
+    if (found != interned_.end())
+        return found->second;
+
+    uint64_t offset = strings_.size();
+    strings_ += text;
+    strings_ += '\0';
+    interned_[text] = offset;
+    return offset;
+}
+
+uint32_t LevelBuilder::addMesh(glm::vec4 center, glm::vec4 scale)
+{
+    LevelMesh mesh = { center, scale, 0, {} };
+    meshes_.push_back(mesh);
+    return (uint32_t)meshes_.size() - 1;
+}
+
+uint32_t LevelBuilder::addUnitQuad()
+{
+    LevelMesh mesh = { glm::vec4(0), glm::vec4(1), 1, {} };
+    meshes_.push_back(mesh);
+    return (uint32_t)meshes_.size() - 1;
+}
+
+uint32_t LevelBuilder::addShader(const char* vertexPath, const char* fragmentPath)
+{
+    LevelShader shader = { { intern(vertexPath) }, { intern(fragmentPath) } };
+    shaders_.push_back(shader);
+    return (uint32_t)shaders_.size() - 1;
+}
+
+uint32_t LevelBuilder::addTexture(const char* path)
+{
+    LevelTexture texture = { { intern(path) } };
+    textures_.push_back(texture);
+    return (uint32_t)textures_.size() - 1;
+}
+
+uint32_t LevelBuilder::addAnimation(const char* folderPath, const char* repeatedName, int frameCount,
+    float frameDuration, float frameDelay)
+{
+    LevelAnimation animation = { { intern(folderPath) }, { intern(repeatedName) }, frameCount,
+        frameDuration, frameDelay, 0 };
+    animations_.push_back(animation);
+    return (uint32_t)animations_.size() - 1;
+}
+
+uint32_t LevelBuilder::addEntity(const char* name, const glm::mat4& transform, uint32_t mesh,
+    uint32_t shader, uint32_t texture, uint32_t animation)
+{
+    LevelEntity entity = { transform, { intern(name) }, mesh, shader, texture, animation };
+    entities_.push_back(entity);
+    return (uint32_t)entities_.size() - 1;
+}
+
+//helper, copies a section into the blob and records where its pointers are.
+//pointers hold offsets into the pool and become offsets into the file here
+template <typename T>
+static void writeSection(std::vector<unsigned char>& blob, LevelTable& table, const std::vector<T>& records,
+    const size_t* pointerFields, size_t pointerCount, uint64_t stringsOffset, std::vector<uint32_t>& relocations)
+{
+    table.offset = align16(blob.size());
+    table.count = (uint32_t)records.size();
+    blob.resize(table.offset + records.size() * sizeof(T));
+
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        unsigned char* record = blob.data() + table.offset + i * sizeof(T);
+        memcpy(record, &records[i], sizeof(T));
+
+        for (size_t p = 0; p < pointerCount; ++p)
+        {
+            uint64_t value;
+            memcpy(&value, record + pointerFields[p], sizeof(value));
+            value += stringsOffset;
+            memcpy(record + pointerFields[p], &value, sizeof(value));
+            relocations.push_back((uint32_t)(record + pointerFields[p] - blob.data()));
+        }
+    }
+}
+
+bool LevelBuilder::write(const char* path) const
+{
+    //the pool goes after every record, so its offset is known before any record is written
+    size_t stringsOffset = align16(sizeof(LevelHeader));
+    stringsOffset = align16(stringsOffset + entities_.size() * sizeof(LevelEntity));
+    stringsOffset = align16(stringsOffset + meshes_.size() * sizeof(LevelMesh));
+    stringsOffset = align16(stringsOffset + shaders_.size() * sizeof(LevelShader));
+    stringsOffset = align16(stringsOffset + textures_.size() * sizeof(LevelTexture));
+    stringsOffset = align16(stringsOffset + animations_.size() * sizeof(LevelAnimation));
+
+    LevelHeader header = {};
+    memcpy(header.magic, "HHLV", 4);
+    header.version = LEVEL_FILE_VERSION;
+
+    std::vector<unsigned char> blob(sizeof(LevelHeader));
+    std::vector<uint32_t> relocations;
+
+    writeSection(blob, header.entities, entities_, entityPointers, 1, stringsOffset, relocations);
+    writeSection(blob, header.meshes, meshes_, nullptr, 0, stringsOffset, relocations);
+    writeSection(blob, header.shaders, shaders_, shaderPointers, 2, stringsOffset, relocations);
+    writeSection(blob, header.textures, textures_, texturePointers, 1, stringsOffset, relocations);
+    writeSection(blob, header.animations, animations_, animationPointers, 2, stringsOffset, relocations);
+
+    header.strings.offset = align16(blob.size());
+    header.strings.count = (uint32_t)strings_.size();
+    blob.resize(header.strings.offset + strings_.size());
+    memcpy(blob.data() + header.strings.offset, strings_.data(), strings_.size());
+
+    header.relocations.offset = align16(blob.size());
+    header.relocations.count = (uint32_t)relocations.size();
+    blob.resize(header.relocations.offset + relocations.size() * sizeof(uint32_t));
+    memcpy(blob.data() + header.relocations.offset, relocations.data(), relocations.size() * sizeof(uint32_t));
+
+    header.fileSize = (uint32_t)blob.size();
+    memcpy(blob.data(), &header, sizeof(header));
+
+    std::ofstream outFile(path, std::ofstream::out | std::ofstream::binary);
+    if (!outFile.is_open())
+    {
+        std::cout << "ERROR::LEVEL_BUILDER::COULD_NOT_OPEN " << path << std::endl;
+        return false;
+    }
+
+    outFile.write((const char*)blob.data(), (std::streamsize)blob.size());
+    return (bool)outFile;
+}
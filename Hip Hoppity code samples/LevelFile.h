@@ -0,0 +1,193 @@
+/*
+ * file: LevelFile.h
+ * author: Mark Kouris
+ * brief: the interface of the LevelFile and LevelBuilder classes and the level file layout.
+ *        A level is one relocatable blob: entity transforms, mesh references,
+ *        animation definitions and resource tables. Loading maps the file and
+ *        turns its offsets into pointers, nothing is parsed or copied.
+ *
+ */
+#pragma once
+#include "glm/glm/glm.hpp"
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* File layout:
+
+    LevelHeader
+    entities    LevelEntity[entities.count]
+    meshes      LevelMesh[meshes.count]
+    shaders     LevelShader[shaders.count]
+    textures    LevelTexture[textures.count]
+    animations  LevelAnimation[animations.count]
+    strings     strings.count bytes of NUL terminated strings, each stored once
+    relocations uint32_t[relocations.count], file offsets of every LevelPointer
+
+Every section starts on a 16 byte boundary and sits at the offset its table
+gives. Records refer to each other by index into their section, NONE for no
+reference. Strings are LevelPointers, the file holds their offset from the
+start of the blob and LevelFile::open adds the mapped address to each one
+listed in relocations.
+
+*/
+
+#define LEVEL_FILE_VERSION 1
+
+//a pointer inside the blob, an offset on disk and an address once the level is open.
+//64 bits either way so the layout is the same for 32 and 64 bit builds
+template <typename T>
+struct LevelPointer
+{
+    uint64_t value;
+
+    const T* get() const { return (const T*)(uintptr_t)value; }
+};
+
+struct LevelTable
+{
+    uint32_t offset; // bytes from the start of the file
+    uint32_t count;  // records, or bytes for the string pool
+};
+
+struct LevelHeader
+{
+    char magic[4];          // "HHLV"
+    uint32_t version;       // LEVEL_FILE_VERSION
+    uint32_t fileSize;      // bytes, a shorter file is truncated
+    uint32_t reserved;
+    LevelTable entities;
+    LevelTable meshes;
+    LevelTable shaders;
+    LevelTable textures;
+    LevelTable animations;
+    LevelTable strings;
+    LevelTable relocations;
+};
+
+//a quad as Mesh(center, scale) or the unit quad builds it
+struct LevelMesh
+{
+    glm::vec4 center;
+    glm::vec4 scale;
+    uint32_t unit;          // 1 for MeshRegistry::unitQuad, center and scale are ignored
+    uint32_t reserved[3];
+};
+
+struct LevelShader
+{
+    LevelPointer<char> vertexPath;
+    LevelPointer<char> fragmentPath;
+};
+
+struct LevelTexture
+{
+    LevelPointer<char> path;
+};
+
+//the arguments of the Animation constructors
+struct LevelAnimation
+{
+    LevelPointer<char> folderPath;
+    LevelPointer<char> repeatedName;
+    int32_t frameCount;
+    float frameDuration;    // seconds each frame is shown
+    float frameDelay;       // seconds before the first change
+    uint32_t reserved;
+};
+
+struct LevelEntity
+{
+    glm::mat4 transform;    // world transform
+    LevelPointer<char> name;
+    uint32_t mesh;          // index into meshes, or NONE
+    uint32_t shader;        // index into shaders, or NONE
+    uint32_t texture;       // index into textures, or NONE
+    uint32_t animation;     // index into animations, or NONE
+};
+
+static_assert(sizeof(LevelHeader) == 72, "level header layout changed, bump LEVEL_FILE_VERSION");
+static_assert(sizeof(LevelMesh) == 48, "level mesh layout changed, bump LEVEL_FILE_VERSION");
+static_assert(sizeof(LevelShader) == 16, "level shader layout changed, bump LEVEL_FILE_VERSION");
+static_assert(sizeof(LevelAnimation) == 32, "level animation layout changed, bump LEVEL_FILE_VERSION");
+static_assert(sizeof(LevelEntity) == 88, "level entity layout changed, bump LEVEL_FILE_VERSION");
+
+//a level mapped into memory, records stay valid until close()
+class LevelFile
+{
+public:
+    static const uint32_t NONE = 0xFFFFFFFF;
+
+    LevelFile() = default;
+    ~LevelFile();
+
+    LevelFile(const LevelFile&) = delete;
+    LevelFile& operator=(const LevelFile&) = delete;
+
+    //maps the file and fixes up its pointers, false when it is missing or not a valid level
+    bool open(const char* path);
+    void close();
+
+    //gettors
+    bool isOpen() const;
+    size_t byteSize() const;
+    const LevelEntity* getEntities() const;
+    uint32_t getEntityCount() const;
+    const LevelMesh* getMeshes() const;
+    uint32_t getMeshCount() const;
+    const LevelShader* getShaders() const;
+    uint32_t getShaderCount() const;
+    const LevelTexture* getTextures() const;
+    uint32_t getTextureCount() const;
+    const LevelAnimation* getAnimations() const;
+    uint32_t getAnimationCount() const;
+
+private:
+    bool validate(const char* path) const;
+
+    template <typename T>
+    const T* section(const LevelTable& table) const
+    {
+        return (const T*)(data_ + table.offset);
+    }
+
+    unsigned char* data_ = nullptr; // the mapping, private copy on write
+    size_t size_ = 0;               // bytes mapped
+#ifdef _WIN32
+    void* file_ = nullptr;          // HANDLE of the open file
+    void* mapping_ = nullptr;       // HANDLE of the file mapping
+#endif
+};
+
+//collects a level in memory and writes it out as one blob, used by tools and the editor
+class LevelBuilder
+{
+public:
+    //each returns the index other records use to refer to the new one
+    uint32_t addMesh(glm::vec4 center, glm::vec4 scale);
+    uint32_t addUnitQuad();
+    uint32_t addShader(const char* vertexPath, const char* fragmentPath);
+    uint32_t addTexture(const char* path);
+    uint32_t addAnimation(const char* folderPath, const char* repeatedName, int frameCount,
+        float frameDuration, float frameDelay);
+    uint32_t addEntity(const char* name, const glm::mat4& transform, uint32_t mesh = LevelFile::NONE,
+        uint32_t shader = LevelFile::NONE, uint32_t texture = LevelFile::NONE,
+        uint32_t animation = LevelFile::NONE);
+
+    //false when the file cannot be written
+    bool write(const char* path) const;
+
+private:
+    //strings are written once each, pointers hold their offset in the pool until write
+    uint64_t intern(const char* text);
+
+    std::vector<LevelEntity> entities_;
+    std::vector<LevelMesh> meshes_;
+    std::vector<LevelShader> shaders_;
+    std::vector<LevelTexture> textures_;
+    std::vector<LevelAnimation> animations_;
+    std::string strings_;                                // the pool, NUL after every string
+    std::unordered_map<std::string, uint64_t> interned_; // string to its offset in the pool
+};
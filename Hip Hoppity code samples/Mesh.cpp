@@ -11,87 +11,66 @@
 
 #include "Log.h"
 #include "Mesh.h" //has glm included
+#include "MeshRegistry.h"
+#include "Resources.h"
+#include "GLState.h"
+#include "Engine.h"
+#include "SystemManager.h"
 #include "glm/glm/gtc/type_ptr.inl"
 #include "glm/glm/gtc/matrix_transform.hpp"
 
-#define VERTICIES_COUNT 32
+#define VERTICIES_COUNT 4
 #define INDICIES_COUNT 6
 
 //default Mesh ctor, makes square mesh
-Mesh::Mesh()
+Mesh::Mesh() : handle_(MeshRegistry::acquire()), unit_(true)
 {
-    data_ = std::make_shared<data>();
-    data_->center_ = glm::vec4(0, 0, 1.f, 1.f);     //centered at origin by default
-    data_->scale_ = glm::vec4(0.5f, 1.f, 1.f, 1.f); // this is the length of the X and Y axis, half is offset
-
-    float vertices[] = {
-        //positions          // colors           // texture coords
-        0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f, // top right
-        0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f, // bottom right
-       -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f, // bottom left
-       -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f  // top left 
-    };
-
-    unsigned int indices[] =
-    {
-        // note that we start from 0!
-        0, 1, 3, // first Triangle
-        1, 2, 3  // second Triangle
-    };
-
-    //generates vertex array and buffers.
-    glGenVertexArrays(1, &data_->VAO);
-    glGenBuffers(1, &data_->VBO);
-    glGenBuffers(1, &data_->EBO);
-
-    //bind the objects to the arrays of objects
-    glBindVertexArray(data_->VAO);
-
-    //link data
-    glBindBuffer(GL_ARRAY_BUFFER, data_->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    //link data
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data_->EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    //set position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    //set color attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    //set texture coordinate attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-   
+    center_ = glm::vec4(0, 0, 1.f, 1.f);     //centered at origin by default
+    scale_ = glm::vec4(0.5f, 1.f, 1.f, 1.f); // this is the length of the X and Y axis, half is offset
 }
 
-//nondefault ctor, makes square mesh centered around vector
-Mesh::Mesh(glm::vec4 center, glm::vec4 scale)
+//nondefault ctor, makes square mesh centered around vector.
+//the vertices stay the unit quad, localTransform moves and stretches it at draw
+Mesh::Mesh(glm::vec4 center, glm::vec4 scale) : handle_(MeshRegistry::acquire()), unit_(false)
 {
-    data_ = std::make_shared<data>();
-    data_->center_ = center; // the world coordinate to base mesh on
-    data_->scale_ = scale;   // this is the length of the X and Y axis, half is offset
+    center_ = center; // the world coordinate to base mesh on
+    scale_ = scale;   // this is the length of the X and Y axis, half is offset
+}
 
-    //max and min points calculated for readability
-    float minX = data_->center_.x - data_->scale_.x / 2;
-    float maxX = data_->center_.x + data_->scale_.x / 2;
-    float minY = data_->center_.y - data_->scale_.y / 2;
-    float maxY = data_->center_.y + data_->scale_.y / 2;
+//helper, a static buffer holding data, made on the engine's upload context.
+//without one (the service could not get a context) it is made on this one
+static unsigned int createBuffer(const void* data, size_t bytes)
+{
+    UploadService& uploads = SysManager::GetEngine()->GetUploadService();
+    const unsigned char* begin = (const unsigned char*)data;
+    UploadService::UploadTicket ticket = uploads.createBuffer(std::vector<unsigned char>(begin, begin + bytes));
+    uploads.wait(ticket);
+    unsigned int buffer = uploads.getObject(ticket);
+    uploads.forget(ticket);
+
+    if (!buffer)
+    {
+        glGenBuffers(1, &buffer);
+        GLState::bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)bytes, data, GL_STATIC_DRAW);
+    }
+    return buffer;
+}
 
+//builds the GL objects for the unit quad, -0.5 to 0.5 on x and y.
+//Resources owns them from here on and deletes them when the handle is collected
+MeshHandle Mesh::createQuad()
+{
+    MeshResource quad = { 0, 0, 0, INDICIES_COUNT };
 
-    //calc edges using + or - the dimensions for x and y
-    float vertices[] =
+    //calc edges using + or - half of the unit width and height
+    Vertex vertices[] =
     {
-        //position          //color values      //texture coords
-        maxX, maxY, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f,      //upper right corner,  point 0
-        maxX, minY, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f,      //bottom right corner, point 1
-        minX, minY, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,      //bottem left corner,  point 2
-        minX, maxY, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f,      //upper left corner,   point 3
-
+        //position            //colors                          //texture coords
+        { {  0.5f,  0.5f },   UNorm8x4(1.0f, 0.0f, 0.0f),   UNorm16x2(1.0f, 1.0f) },   //upper right corner,  point 0
+        { {  0.5f, -0.5f },   UNorm8x4(0.0f, 1.0f, 0.0f),   UNorm16x2(1.0f, 0.0f) },   //bottom right corner, point 1
+        { { -0.5f, -0.5f },   UNorm8x4(0.0f, 0.0f, 1.0f),   UNorm16x2(0.0f, 0.0f) },   //bottem left corner,  point 2
+        { { -0.5f,  0.5f },   UNorm8x4(1.0f, 1.0f, 0.0f),   UNorm16x2(0.0f, 1.0f) },   //upper left corner,   point 3
     };
 
     unsigned int indices[] =
@@ -101,41 +80,22 @@ Mesh::Mesh(glm::vec4 center, glm::vec4 scale)
         1, 2, 3  // second Triangle
     };
 
-    //generates the buffers and vertex array for use
-    glGenVertexArrays(1, &data_->VAO);
-    glGenBuffers(1, &data_->VBO);
-    glGenBuffers(1, &data_->EBO);
-
-    //bind the objects to the arrays of objects
-    glBindVertexArray(data_->VAO);
+    //the buffers go through the upload service, vertex arrays are not shared
+    //between contexts so that one is made here
+    quad.VBO = createBuffer(vertices, sizeof(vertices));
+    quad.EBO = createBuffer(indices, sizeof(indices));
+    glGenVertexArrays(1, &quad.VAO);
 
-    //link data
-    glBindBuffer(GL_ARRAY_BUFFER, data_->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    //bind the objects to the arrays of objects, the first bind on this
+    //context is also what makes the uploaded contents visible here
+    GLState::bindVertexArray(quad.VAO);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, quad.VBO);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad.EBO);
 
-    //link data
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data_->EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    //position, color and texture coordinate attributes, offsets and stride come from Vertex
+    VertexFormat::apply<Vertex>();
 
-    //set position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    //set color attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    //set texture coordinate attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-}
-
-//default dtor, cleans up all buffers and arrays.
-Mesh::data::~data()
-{
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    return Resources::current().addMesh(quad);
 }
 
 //GETTORS
@@ -143,13 +103,13 @@ Mesh::data::~data()
 //this is the center point of the mesh (in NDC)
 glm::vec4 Mesh::center(void) const
 {
-    return data_->center_;
+    return center_;
 }
 
 //this is the length of the width and height based on NDC
 glm::vec4 Mesh::scale(void) const
 {
-    return data_->scale_;
+    return scale_;
 }
 
 //Will not be constant when we make more than just square meshes
@@ -164,16 +124,34 @@ int Mesh::indiciesCount(void) const
     return INDICIES_COUNT;
 }
 
+//places the unit quad where this mesh's center and scale say, the unit quad itself needs nothing
+glm::mat4 Mesh::localTransform(void) const
+{
+    if (unit_)
+        return glm::mat4(1.0f);
+
+    return MeshRegistry::quadTransform(center_, scale_);
+}
+
+//the GL names are 0 once the quad was released and collected
 unsigned int Mesh::getVAO()const
 {
-    return data_->VAO;
+    const MeshResource* mesh = Resources::current().get(handle_);
+    return mesh ? mesh->VAO : 0;
 }
 unsigned int Mesh::getVBO()const
 {
-    return data_->VBO;
+    const MeshResource* mesh = Resources::current().get(handle_);
+    return mesh ? mesh->VBO : 0;
 }
 
 unsigned int Mesh::getEBO()const
 {
-    return data_->EBO;
+    const MeshResource* mesh = Resources::current().get(handle_);
+    return mesh ? mesh->EBO : 0;
+}
+
+MeshHandle Mesh::getHandle()const
+{
+    return handle_;
 }
\ No newline at end of file
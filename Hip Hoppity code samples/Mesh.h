@@ -12,14 +12,36 @@
 #include <glad/glad.h>
 #include "Transform.h" /* Used for Sprite and connecting components */
 #include <array>
-#include <memory>   //std::shared_ptr
+#include "VertexFormat.h"
+#include "ResourcePool.h"
 #include "glm/glm/mat4x4.hpp"
 
+class MeshRegistry;
+struct MeshResource; //Resources.h
+typedef ResourcePool<MeshResource>::Handle MeshHandle;
+
 class Mesh
 {
 public:
+    //what the quads are built from, 16 bytes a vertex
+    struct Vertex
+    {
+        glm::vec2 position; //location 0, reaches a vec3 input with z = 0
+        UNorm8x4 color;     //location 1
+        UNorm16x2 uv;       //location 2
+
+        static constexpr std::array<VertexAttribute, 3> layout()
+        {
+            return {{ VERTEX_ATTRIBUTE(Vertex, position, 0),
+                      VERTEX_ATTRIBUTE(Vertex, color, 1),
+                      VERTEX_ATTRIBUTE(Vertex, uv, 2) }};
+        }
+    };
+
+    //both ctors share the unit quad from the MeshRegistry, only one quad is ever uploaded.
+    //a Mesh is a handle into Resources, it never frees the buffers itself
     Mesh();  //default ctor, creates mesh around 0,0 and scale is 1,1
-    Mesh(glm::vec4 center, glm::vec4 scale); //greats a mesh based around a center point.
+    Mesh(glm::vec4 center, glm::vec4 scale); //greats a mesh based around a center point, see localTransform
 
     //gettors
     glm::vec4 center(void) const;
@@ -27,23 +49,25 @@ public:
     unsigned int getVAO()const;
     unsigned int getVBO()const;
     unsigned int getEBO()const;
+    MeshHandle getHandle()const;
     int verticiesCount(void) const;
     int indiciesCount(void) const;
 
+    //translate and scale that places the unit quad where this mesh's center and scale say,
+    //the draw paths (RenderQueue, SpriteBatch) multiply it after the object transform
+    glm::mat4 localTransform(void) const;
+
 private:
-    struct data
-    {
-        unsigned int VAO; //used to bind the vertex array
-        unsigned int VBO; //the vertex buffer object
-        unsigned int EBO; //the element buffer object
-        glm::vec4 center_; //center for this mesh
-        glm::vec4 scale_;  //the scale for this mesh
+    friend class MeshRegistry;
 
-        ~data();
-    };
+    //builds the GL objects for the unit quad and adds them to Resources, only the registry calls this
+    static MeshHandle createQuad();
 
-    //shared pointer to have multiple sprites reference this mesh
-    std::shared_ptr<data> data_; 
+    //the pool entry holding the GL objects, shared by every sprite using this quad
+    MeshHandle handle_;
+    glm::vec4 center_; //center for this mesh
+    glm::vec4 scale_;  //the scale for this mesh
+    bool unit_;        //whether this is the unit quad as is, localTransform is identity
    
 
 };
\ No newline at end of file
@@ -0,0 +1,62 @@
+/*
+ * file: MeshRegistry.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the MeshRegistry class,
+ *        this shares the one quad made by Mesh.
+ */
+
+#include "MeshRegistry.h"
+#include "Resources.h"
+#include "glm/glm/gtc/matrix_transform.hpp"
+
+#define UNIT_QUAD_KEY "quad" //every Mesh is the unit quad plus a local transform
+
+std::unordered_map<std::string, MeshHandle> MeshRegistry::meshes_;
+
+Mesh MeshRegistry::unitQuad()
+{
+    return Mesh();
+}
+
+Mesh MeshRegistry::quad(glm::vec4 center, glm::vec4 scale)
+{
+    return Mesh(center, scale);
+}
+
+//the unit quad is 1 wide and tall, so scale stretches it and center moves it
+glm::mat4 MeshRegistry::quadTransform(glm::vec4 center, glm::vec4 scale)
+{
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(center.x, center.y, 0.0f));
+    return glm::scale(transform, glm::vec3(scale.x, scale.y, 1.0f));
+}
+
+unsigned int MeshRegistry::liveMeshes()
+{
+    unsigned int live = 0;
+    for (const auto& entry : meshes_)
+        live += Resources::current().get(entry.second) ? 1 : 0;
+    return live;
+}
+
+void MeshRegistry::purge()
+{
+    for (const auto& entry : meshes_)
+        Resources::current().release(entry.second);
+    meshes_.clear();
+}
+
+MeshHandle MeshRegistry::acquire()
+{
+    return acquire(UNIT_QUAD_KEY, &Mesh::createQuad);
+}
+
+MeshHandle MeshRegistry::acquire(const std::string& key, MeshHandle (*build)())
+{
+    MeshHandle& mesh = meshes_[key];
+    if (Resources::current().get(mesh))
+        return mesh;
+
+    //first request, or it was released, build it again
+    mesh = build();
+    return mesh;
+}
@@ -0,0 +1,46 @@
+/*
+ * file: MeshRegistry.h
+ * author: Mark Kouris
+ * brief: the interface of the MeshRegistry class.
+ *        Hands out the one shared unit quad, so thousands of sprites of any
+ *        size only need one VAO/VBO/EBO. Meshes are kept by key as handles
+ *        into Resources, the first request for a key builds it.
+ *
+ */
+#pragma once
+#include "Mesh.h"
+#include <string>
+#include <unordered_map>
+
+class MeshRegistry
+{
+public:
+    //the one quad every transform driven sprite should use, -0.5 to 0.5 on x and y
+    static Mesh unitQuad();
+
+    //a quad with this center and scale, it shares the unit quad's buffers and
+    //carries the difference in Mesh::localTransform
+    static Mesh quad(glm::vec4 center, glm::vec4 scale);
+
+    //model matrix piece that turns the unit quad into the quad with this center and scale,
+    //multiply it after the object transform instead of baking it into vertices
+    static glm::mat4 quadTransform(glm::vec4 center, glm::vec4 scale);
+
+    //how many registered meshes currently have GL buffers alive
+    static unsigned int liveMeshes();
+
+    //releases every registered mesh, they are deleted on the next Resources::collect.
+    //meshes made before this stop drawing, so only call it once nothing uses them (between levels)
+    static void purge();
+
+private:
+    friend class Mesh;
+
+    //the live unit quad, or a new one
+    static MeshHandle acquire();
+
+    //the live mesh under key, built by build when there is none
+    static MeshHandle acquire(const std::string& key, MeshHandle (*build)());
+
+    static std::unordered_map<std::string, MeshHandle> meshes_; // key to its handle in Resources
+};
@@ -0,0 +1,195 @@
+/*
+ * file: ProgramCache.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the ProgramCache class,
+ *        this stores and loads linked program binaries.
+ */
+
+#include "ProgramCache.h"
+#include <glad/glad.h>
+#include <cstdio>     // snprintf
+#include <cstring>    // memcmp
+#include <filesystem> // create_directories
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+/* Use Notes:
+
+One file per program, named after its key in hex:
+    ProgramBinaryHeader
+    binary bytes (length from the header)
+
+The key hashes both sources and GL_VENDOR, GL_RENDERER and GL_VERSION, and
+the full key is stored in the header again so a renamed or stale file is
+caught. Even with a matching key the driver may refuse a binary (driver
+update with the same version string), so load() checks the link status
+and the caller compiles from source when it fails.
+
+*/
+
+namespace
+{
+    struct ProgramBinaryHeader
+    {
+        char magic[4];       // "HHPB"
+        uint32_t version;    // PROGRAM_CACHE_VERSION
+        uint64_t key;        // ProgramCache::keyOf of the sources
+        uint32_t format;     // binaryFormat from glGetProgramBinary
+        uint32_t length;     // bytes after the header
+    };
+
+    const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+    //FNV-1a, fast enough for a handful of shaders at startup
+    uint64_t hashBytes(uint64_t hash, const char* bytes, size_t length)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= (unsigned char)bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    //glGetString can return null without a context, hash those as empty
+    uint64_t hashString(uint64_t hash, const GLubyte* text)
+    {
+        const char* chars = text ? (const char*)text : "";
+        return hashBytes(hash, chars, strlen(chars) + 1); //the terminator separates the fields
+    }
+}
+
+std::string ProgramCache::directory_ = "shadercache";
+ProgramCache::Stats ProgramCache::stats_;
+
+void ProgramCache::setDirectory(const std::string& directory)
+{
+    directory_ = directory;
+}
+
+const std::string& ProgramCache::getDirectory()
+{
+    return directory_;
+}
+
+//some drivers expose the entry points but no formats, which means no binaries either
+bool ProgramCache::isSupported()
+{
+    if (directory_.empty() || !(GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary))
+        return false;
+
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+bool ProgramCache::load(unsigned int program, const std::string& vertexCode, const std::string& fragmentCode)
+{
+    if (!isSupported())
+        return false;
+
+    uint64_t key = keyOf(vertexCode, fragmentCode);
+    std::ifstream inFile(pathOf(key), std::ifstream::in | std::ifstream::binary);
+    if (!inFile.is_open())
+        return false;
+
+    ProgramBinaryHeader header;
+    inFile.read((char*)&header, sizeof(header));
+    if (!inFile || memcmp(header.magic, "HHPB", 4) != 0 || header.version != PROGRAM_CACHE_VERSION ||
+        header.key != key)
+        return false;
+
+    std::vector<char> binary(header.length);
+    inFile.read(binary.data(), header.length);
+    if (!inFile)
+        return false;
+
+    glProgramBinary(program, header.format, binary.data(), (GLsizei)header.length);
+
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+        reject();
+    return success != 0;
+}
+
+bool ProgramCache::store(unsigned int program, const std::string& vertexCode, const std::string& fragmentCode)
+{
+    if (!isSupported())
+        return false;
+
+    int success = 0;
+    int length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!success || length <= 0)
+        return false;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    ProgramBinaryHeader header;
+    memcpy(header.magic, "HHPB", 4);
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = keyOf(vertexCode, fragmentCode);
+    header.format = format;
+    header.length = (uint32_t)length;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+
+    std::ofstream outFile(pathOf(header.key), std::ofstream::out | std::ofstream::binary);
+    if (!outFile.is_open())
+    {
+        std::cout << "ERROR::PROGRAM_CACHE::COULD_NOT_OPEN " << pathOf(header.key) << std::endl;
+        return false;
+    }
+
+    outFile.write((const char*)&header, sizeof(header));
+    outFile.write(binary.data(), length);
+    return (bool)outFile;
+}
+
+void ProgramCache::record(bool hit, float milliseconds)
+{
+    if (hit)
+    {
+        stats_.hits += 1;
+        stats_.hitMilliseconds += milliseconds;
+    }
+    else
+    {
+        stats_.misses += 1;
+        stats_.missMilliseconds += milliseconds;
+    }
+}
+
+void ProgramCache::reject()
+{
+    stats_.rejected += 1;
+}
+
+const ProgramCache::Stats& ProgramCache::getStats()
+{
+    return stats_;
+}
+
+uint64_t ProgramCache::keyOf(const std::string& vertexCode, const std::string& fragmentCode)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = hashBytes(hash, vertexCode.c_str(), vertexCode.size() + 1);
+    hash = hashBytes(hash, fragmentCode.c_str(), fragmentCode.size() + 1);
+    hash = hashString(hash, glGetString(GL_VENDOR));
+    hash = hashString(hash, glGetString(GL_RENDERER));
+    hash = hashString(hash, glGetString(GL_VERSION));
+    return hash;
+}
+
+std::string ProgramCache::pathOf(uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return directory_ + "/" + name;
+}
@@ -0,0 +1,51 @@
+/*
+ * file: ProgramCache.h
+ * author: Mark Kouris
+ * brief: the interface of the ProgramCache class.
+ *        Keeps linked shader programs on disk with glGetProgramBinary so later
+ *        launches skip compiling and linking. Entries are keyed by a hash of the
+ *        shader source and the driver strings, a new driver or an edited shader
+ *        simply misses and is compiled again.
+ *
+ */
+#pragma once
+#include <string>
+#include <cstdint>
+
+class ProgramCache
+{
+public:
+    struct Stats
+    {
+        unsigned int hits = 0;        // programs loaded from a binary
+        unsigned int misses = 0;      // programs compiled from source
+        unsigned int rejected = 0;    // binaries the driver would not link, also counted as misses
+        float hitMilliseconds = 0.f;  // total time spent creating programs from binaries
+        float missMilliseconds = 0.f; // total time spent compiling programs
+    };
+
+    //where binaries are kept, empty turns the cache off. Default is "shadercache"
+    static void setDirectory(const std::string& directory);
+    static const std::string& getDirectory();
+
+    //true when the driver can hand out program binaries
+    static bool isSupported();
+
+    //tries to fill program from a stored binary, true when it linked
+    static bool load(unsigned int program, const std::string& vertexCode, const std::string& fragmentCode);
+
+    //stores a linked program, program must have been linked with the retrievable hint set
+    static bool store(unsigned int program, const std::string& vertexCode, const std::string& fragmentCode);
+
+    //Shader reports how long each program took and where it came from
+    static void record(bool hit, float milliseconds);
+    static const Stats& getStats();
+
+private:
+    static void reject();
+    static uint64_t keyOf(const std::string& vertexCode, const std::string& fragmentCode);
+    static std::string pathOf(uint64_t key);
+
+    static std::string directory_; // where binaries are kept
+    static Stats stats_;           // totals since startup
+};
@@ -0,0 +1,173 @@
+/*
+ * file: RenderQueue.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the RenderQueue class,
+ *        this sorts draw commands by key and executes them.
+ */
+
+#include "RenderQueue.h"
+#include "GLState.h"
+
+/* Use Notes:
+
+GL names are masked into the key, so two shaders or textures can land in the
+same bucket once a program has thousands of them. That only costs an extra
+state change, the command itself always carries the real names.
+
+The sort is least significant byte first, and passes where every key has
+the same byte (unused layers, one shader) are skipped.
+
+*/
+
+RenderQueue::RenderQueue(unsigned int expectedCommands)
+{
+    keys_.reserve(expectedCommands);
+    order_.reserve(expectedCommands);
+    commands_.reserve(expectedCommands);
+    models_.reserve(expectedCommands);
+}
+
+unsigned long long RenderQueue::makeKey(unsigned char layer, unsigned int shader, unsigned int texture,
+    unsigned int mesh, float depth)
+{
+    depth = depth < 0.f ? 0.f : (depth > 1.f ? 1.f : depth);
+    unsigned long long depthBits = (unsigned long long)(depth * 65535.f);
+
+    return ((unsigned long long)layer << 56) |
+           ((unsigned long long)(shader & 0xFFF) << 44) |
+           ((unsigned long long)(texture & 0xFFFF) << 28) |
+           ((unsigned long long)(mesh & 0xFFF) << 16) |
+           depthBits;
+}
+
+void RenderQueue::submit(const Shader& shader, const Mesh& mesh, unsigned int texture, const glm::mat4& model,
+    unsigned char layer, float depth)
+{
+    command c;
+    c.shader = shader;
+    c.VAO = mesh.getVAO();
+    c.texture = texture;
+    c.indexCount = (unsigned int)mesh.indiciesCount();
+    c.model = (unsigned int)models_.size();
+
+    keys_.push_back(makeKey(layer, shader.getID(), texture, c.VAO, depth));
+    order_.push_back((unsigned int)commands_.size());
+    commands_.push_back(c);
+    models_.push_back(model * mesh.localTransform()); //meshes share the unit quad, this places it
+}
+
+//sorts and draws everything submitted this frame
+void RenderQueue::execute()
+{
+    stats_ = Stats();
+    if (commands_.empty())
+        return;
+
+    countSubmittedChanges();
+    radixSort();
+
+    Shader program;
+    unsigned int modelLocation = 0;
+    unsigned int VAO = 0;
+    unsigned int texture = 0;
+    bool first = true;
+
+    for (unsigned int index : order_)
+    {
+        const command& c = commands_[index];
+
+        if (first || c.shader.getHandle() != program.getHandle())
+        {
+            c.shader.use();
+            program = c.shader;
+            modelLocation = c.shader.getModelLoc();
+            ++stats_.programChanges;
+        }
+        if (first || c.VAO != VAO)
+        {
+            GLState::bindVertexArray(c.VAO);
+            VAO = c.VAO;
+            ++stats_.meshChanges;
+        }
+        if (first || c.texture != texture)
+        {
+            GLState::bindTexture(0, GL_TEXTURE_2D, c.texture);
+            texture = c.texture;
+            ++stats_.textureChanges;
+        }
+        first = false;
+
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &models_[c.model][0][0]);
+        glDrawElements(GL_TRIANGLES, c.indexCount, GL_UNSIGNED_INT, 0);
+        ++stats_.draws;
+    }
+
+    GLState::bindVertexArray(0);
+
+    keys_.clear();
+    order_.clear();
+    commands_.clear();
+    models_.clear();
+}
+
+const RenderQueue::Stats& RenderQueue::getStats() const
+{
+    return stats_;
+}
+
+//least significant byte first, 8 passes at most
+void RenderQueue::radixSort()
+{
+    const size_t count = keys_.size();
+    keysTemp_.resize(count);
+    orderTemp_.resize(count);
+
+    //bits that differ between any two keys, passes outside them do nothing
+    unsigned long long differing = 0;
+    for (size_t i = 1; i < count; ++i)
+        differing |= keys_[i] ^ keys_[0];
+
+    for (unsigned int shift = 0; shift < 64; shift += 8)
+    {
+        if (((differing >> shift) & 0xFF) == 0)
+            continue;
+
+        unsigned int offsets[256] = {};
+        for (size_t i = 0; i < count; ++i)
+            ++offsets[(keys_[i] >> shift) & 0xFF];
+
+        unsigned int total = 0;
+        for (unsigned int& offset : offsets)
+        {
+            unsigned int bucket = offset;
+            offset = total;
+            total += bucket;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            unsigned int slot = offsets[(keys_[i] >> shift) & 0xFF]++;
+            keysTemp_[slot] = keys_[i];
+            orderTemp_[slot] = order_[i];
+        }
+
+        keys_.swap(keysTemp_);
+        order_.swap(orderTemp_);
+    }
+}
+
+//what the same commands would cost drawn in the order they came in
+void RenderQueue::countSubmittedChanges()
+{
+    for (size_t i = 0; i < commands_.size(); ++i)
+    {
+        const command& c = commands_[i];
+        bool first = i == 0;
+        if (first || c.shader.getHandle() != commands_[i - 1].shader.getHandle())
+            ++stats_.submittedProgramChanges;
+        if (first || c.VAO != commands_[i - 1].VAO)
+            ++stats_.submittedMeshChanges;
+        if (first || c.texture != commands_[i - 1].texture)
+            ++stats_.submittedTextureChanges;
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * file: RenderQueue.h
+ * author: Mark Kouris
+ * brief: the interface of the RenderQueue class.
+ *        Systems submit compact draw commands with a 64 bit sort key instead of
+ *        drawing straight away. The queue radix sorts the keys once per frame and
+ *        draws everything in one pass, only changing GL state when it differs
+ *        from the previous command.
+ *
+ */
+#pragma once
+#include <glad/glad.h>
+#include "glm/glm/glm.hpp"
+#include <vector>
+#include "Shader.h"
+#include "Mesh.h"
+
+class RenderQueue
+{
+public:
+    //state changes for one frame, submitted is what drawing in submit order would cost
+    struct Stats
+    {
+        unsigned int draws = 0;
+        unsigned int programChanges = 0;
+        unsigned int meshChanges = 0;
+        unsigned int textureChanges = 0;
+        unsigned int submittedProgramChanges = 0;
+        unsigned int submittedMeshChanges = 0;
+        unsigned int submittedTextureChanges = 0;
+    };
+
+    RenderQueue(unsigned int expectedCommands = 4096);
+
+    //queues one draw, lower layers draw first, depth is 0 to 1 and sorts front to back.
+    //the mesh's localTransform is applied after model
+    void submit(const Shader& shader, const Mesh& mesh, unsigned int texture, const glm::mat4& model,
+        unsigned char layer = 0, float depth = 0.f);
+
+    //sorts and draws everything submitted this frame
+    void execute();
+
+    //gettors
+    const Stats& getStats() const; //from the last execute
+
+    //key layout, most significant first: layer 8 | shader 12 | texture 16 | mesh 12 | depth 16
+    static unsigned long long makeKey(unsigned char layer, unsigned int shader, unsigned int texture,
+        unsigned int mesh, float depth);
+
+private:
+    struct command
+    {
+        Shader shader;            // program to draw with, a handle so this copies 4 bytes
+        unsigned int VAO;         // mesh vertex array
+        unsigned int texture;     // texture bound on unit 0
+        unsigned int indexCount;  // indices to draw
+        unsigned int model;       // index into models_
+    };
+
+    void radixSort();
+    void countSubmittedChanges();
+
+    std::vector<unsigned long long> keys_;    // sort keys, parallel to order_
+    std::vector<unsigned int> order_;         // command index for each key
+    std::vector<unsigned long long> keysTemp_;// scratch for the radix passes
+    std::vector<unsigned int> orderTemp_;     // scratch for the radix passes
+    std::vector<command> commands_;           // in submit order
+    std::vector<glm::mat4> models_;           // model matrices, kept out of the commands
+    Stats stats_;                             // state changes of the last execute
+};
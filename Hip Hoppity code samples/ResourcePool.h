@@ -0,0 +1,166 @@
+/*
+ * file: ResourcePool.h
+ * author: Mark Kouris
+ * brief: the interface of the ResourcePool class.
+ *        Dense storage for one kind of resource, addressed by 32 bit
+ *        generational handles. A lookup is two array reads, a handle to a
+ *        destroyed resource is detected instead of reading whatever reused
+ *        its slot, and destruction waits for collect() at a safe point.
+ *
+ */
+#pragma once
+#include <cstddef> // size_t
+#include <cstdint>
+#include <iostream>
+#include <utility>  // std::move
+#include <vector>
+
+/* Use Notes:
+
+Handle layout: 20 bits of slot index, 12 bits of generation. The generation
+of a slot goes up every time its resource is destroyed, so old handles stop
+matching. Generations start at 1, so a handle of 0 is never valid. A pool
+holds at most 2^20 resources at once, add() past that prints an error and
+returns an invalid handle instead of reusing an index.
+
+release() only queues the resource. It can still be looked up until the next
+collect(), which lets commands already recorded this frame finish with it.
+
+Resources are kept packed, destroying one moves the last one into its place,
+so pointers from get() are only good until the next add() or collect().
+
+*/
+
+template <typename T>
+class ResourcePool
+{
+public:
+    struct Handle
+    {
+        uint32_t value = 0;
+
+        bool isValid() const { return value != 0; }
+        bool operator==(const Handle& other) const { return value == other.value; }
+        bool operator!=(const Handle& other) const { return value != other.value; }
+    };
+
+    //invalid when the pool is full, the resource is not kept then
+    Handle add(T resource)
+    {
+        uint32_t index;
+        if (!freeSlots_.empty())
+        {
+            index = freeSlots_.back();
+            freeSlots_.pop_back();
+        }
+        else
+        {
+            //the index has to fit its 20 bits, a bigger one would alias slot index & INDEX_MASK
+            if (slots_.size() > INDEX_MASK)
+            {
+                std::cout << "ERROR::RESOURCE_POOL::FULL " << slots_.size() << " slots" << std::endl;
+                return Handle();
+            }
+
+            index = (uint32_t)slots_.size();
+            slots_.push_back(slot());
+        }
+
+        slots_[index].dense = (uint32_t)dense_.size();
+        slots_[index].released = false;
+        dense_.push_back(std::move(resource));
+        denseToSlot_.push_back(index);
+
+        Handle handle;
+        handle.value = (slots_[index].generation << INDEX_BITS) | index;
+        return handle;
+    }
+
+    //null when the handle is stale or was never valid
+    T* get(Handle handle)
+    {
+        uint32_t index = handle.value & INDEX_MASK;
+        if (index >= slots_.size() || slots_[index].generation != handle.value >> INDEX_BITS ||
+            slots_[index].dense == NONE)
+            return nullptr;
+        return &dense_[slots_[index].dense];
+    }
+
+    const T* get(Handle handle) const
+    {
+        return const_cast<ResourcePool*>(this)->get(handle);
+    }
+
+    bool isAlive(Handle handle) const
+    {
+        return get(handle) != nullptr;
+    }
+
+    //queues the resource for the next collect(), releasing twice is harmless
+    void release(Handle handle)
+    {
+        if (!get(handle) || slots_[handle.value & INDEX_MASK].released)
+            return;
+
+        slots_[handle.value & INDEX_MASK].released = true;
+        pending_.push_back(handle);
+    }
+
+    //destroys everything released since the last call, destroy(T&) frees what T owns
+    template <typename Destroy>
+    void collect(Destroy destroy)
+    {
+        for (Handle handle : pending_)
+        {
+            uint32_t index = handle.value & INDEX_MASK;
+            uint32_t dense = slots_[index].dense;
+            destroy(dense_[dense]);
+
+            //keep the array packed, the last resource takes the freed spot
+            uint32_t last = (uint32_t)dense_.size() - 1;
+            if (dense != last)
+            {
+                dense_[dense] = std::move(dense_[last]);
+                denseToSlot_[dense] = denseToSlot_[last];
+                slots_[denseToSlot_[dense]].dense = dense;
+            }
+            dense_.pop_back();
+            denseToSlot_.pop_back();
+
+            slot& freed = slots_[index];
+            freed.dense = NONE;
+            freed.released = false;
+            freed.generation = freed.generation == MAX_GENERATION ? 1 : freed.generation + 1;
+            freeSlots_.push_back(index);
+        }
+
+        pending_.clear();
+    }
+
+    //gettors
+    size_t size() const { return dense_.size(); }
+    size_t pendingCount() const { return pending_.size(); }
+
+    //every live resource, in no particular order
+    typename std::vector<T>::iterator begin() { return dense_.begin(); }
+    typename std::vector<T>::iterator end() { return dense_.end(); }
+
+private:
+    static const uint32_t INDEX_BITS = 20;
+    static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static const uint32_t MAX_GENERATION = (1u << (32 - INDEX_BITS)) - 1;
+    static const uint32_t NONE = 0xFFFFFFFF;
+
+    struct slot
+    {
+        uint32_t generation = 1; // must match the handle's
+        uint32_t dense = NONE;   // where the resource is in dense_, NONE when free
+        bool released = false;   // already waiting in pending_
+    };
+
+    std::vector<T> dense_;              // the resources, packed
+    std::vector<uint32_t> denseToSlot_; // slot of each entry in dense_, for the packing moves
+    std::vector<slot> slots_;           // indexed by the handle
+    std::vector<uint32_t> freeSlots_;   // slots ready to be reused
+    std::vector<Handle> pending_;       // released, destroyed on the next collect()
+};
@@ -0,0 +1,175 @@
+/*
+ * file: Resources.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the Resources class,
+ *        the engine's mesh, shader and texture pools.
+ */
+
+#include "Resources.h"
+#include "MeshRegistry.h"
+#include "GLState.h"
+
+/* Use Notes:
+
+collect() runs after the render queue and sprite batch have been drawn, so
+nothing recorded this frame can still be holding a released GL name. Every
+GL delete happens in here, Mesh and Shader never free anything themselves.
+
+*/
+
+Resources* Resources::current_ = nullptr;
+
+//helpers, free what one pool entry owns
+static void destroyMesh(MeshResource& mesh)
+{
+    glDeleteVertexArrays(1, &mesh.VAO);
+    glDeleteBuffers(1, &mesh.VBO);
+    glDeleteBuffers(1, &mesh.EBO);
+    GLState::forgetVertexArray(mesh.VAO);
+    GLState::forgetBuffer(mesh.VBO);
+    GLState::forgetBuffer(mesh.EBO);
+}
+
+static void destroyShader(ShaderResource& shader)
+{
+    //a deferred shader released before finish() still owns its stages
+    if (shader.vertex)
+        glDeleteShader(shader.vertex);
+    if (shader.fragment)
+        glDeleteShader(shader.fragment);
+
+    glDeleteProgram(shader.program);
+    GLState::forgetProgram(shader.program);
+}
+
+static void destroyTexture(TextureResource& texture)
+{
+    GLState::forgetTexture(texture.texture);
+    glDeleteTextures(1, &texture.texture);
+}
+
+Resources::Resources()
+{
+    current_ = this;
+}
+
+Resources::~Resources()
+{
+    //the registry's handles would match whatever a later Resources puts in the same slots
+    MeshRegistry::purge();
+
+    for (MeshResource& mesh : meshes_)
+        destroyMesh(mesh);
+    for (ShaderResource& shader : shaders_)
+        destroyShader(shader);
+    for (TextureResource& texture : textures_)
+        destroyTexture(texture);
+
+    if (current_ == this)
+        current_ = nullptr;
+}
+
+Resources& Resources::current()
+{
+    return *current_;
+}
+
+MeshHandle Resources::addMesh(const MeshResource& mesh)
+{
+    MeshHandle handle = meshes_.add(mesh);
+    if (!handle.isValid())
+    {
+        MeshResource dropped = mesh;
+        destroyMesh(dropped);
+    }
+    return handle;
+}
+
+ShaderHandle Resources::addShader(ShaderResource shader)
+{
+    unsigned int vertex = shader.vertex;
+    unsigned int fragment = shader.fragment;
+    unsigned int program = shader.program;
+
+    ShaderHandle handle = shaders_.add(std::move(shader));
+    if (!handle.isValid())
+    {
+        ShaderResource dropped;
+        dropped.vertex = vertex;
+        dropped.fragment = fragment;
+        dropped.program = program;
+        destroyShader(dropped);
+    }
+    return handle;
+}
+
+TextureHandle Resources::addTexture(unsigned int texture, int width, int height)
+{
+    TextureResource resource = { texture, width, height };
+    TextureHandle handle = textures_.add(resource);
+    if (!handle.isValid())
+        destroyTexture(resource);
+    return handle;
+}
+
+const MeshResource* Resources::get(MeshHandle handle) const
+{
+    return meshes_.get(handle);
+}
+
+const ShaderResource* Resources::get(ShaderHandle handle) const
+{
+    return shaders_.get(handle);
+}
+
+const TextureResource* Resources::get(TextureHandle handle) const
+{
+    return textures_.get(handle);
+}
+
+ShaderResource* Resources::get(ShaderHandle handle)
+{
+    return shaders_.get(handle);
+}
+
+void Resources::release(MeshHandle handle)
+{
+    meshes_.release(handle);
+}
+
+void Resources::release(ShaderHandle handle)
+{
+    shaders_.release(handle);
+}
+
+void Resources::release(TextureHandle handle)
+{
+    textures_.release(handle);
+}
+
+void Resources::collect()
+{
+    meshes_.collect(destroyMesh);
+    shaders_.collect(destroyShader);
+    textures_.collect(destroyTexture);
+}
+
+size_t Resources::meshCount() const
+{
+    return meshes_.size();
+}
+
+size_t Resources::shaderCount() const
+{
+    return shaders_.size();
+}
+
+size_t Resources::textureCount() const
+{
+    return textures_.size();
+}
+
+size_t Resources::pendingCount() const
+{
+    return meshes_.pendingCount() + shaders_.pendingCount() + textures_.pendingCount();
+}
@@ -0,0 +1,122 @@
+/*
+ * file: Resources.h
+ * author: Mark Kouris
+ * brief: the interface of the Resources class.
+ *        Handle based pools for the engine's meshes, shaders and textures.
+ *        Draw code keeps 32 bit handles and reads the GL names out of packed
+ *        arrays, releases are destroyed together at the end of the frame.
+ *
+ */
+#pragma once
+#include "ResourcePool.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Use Notes:
+
+Mesh and Shader are handles into these pools, copying one copies the handle
+and nothing is reference counted. The GL objects live until the handle is
+released and collect() deletes them, or until Resources goes away.
+
+    Shader shader("shaders/sprite.vert", "shaders/sprite.frag"); //added to the pool
+    ...
+    const ShaderResource* program = resources.get(shader.getHandle()); //null once it is gone
+    GLState::useProgram(program->program);
+    ...
+    resources.release(shader.getHandle()); //still drawable until Engine::Render ends
+
+Whoever constructs a Shader releases it, ShaderLibrary does for its shaders
+and variants when it is destroyed. Engine destroys Resources last, so owners
+can still release into it from their destructors.
+Meshes are shared through MeshRegistry, release those with MeshRegistry::purge.
+Textures are raw GL names the pool takes over, they are deleted by collect().
+TextureStreamer adds every texture it loads and releases it when TextureCache
+evicts it, so eviction never deletes a texture mid frame.
+
+*/
+
+struct MeshResource
+{
+    unsigned int VAO;   //what draws bind
+    unsigned int VBO;   //the vertex buffer
+    unsigned int EBO;   //the element buffer
+    int indexCount;     //for glDrawElements
+};
+
+//everything a Shader handle refers to, only Shader fills this in
+struct ShaderResource
+{
+    unsigned int program = 0;       //what draws use
+    unsigned int modelLocation = 0; //the model matrix uniform, set once the shader is finished
+    std::string vertexPath;         //path to the vertex shader
+    std::string fragmentPath;       //path to the fragment shader
+    std::vector<std::string> defines;                       //what this variant was built with
+    std::vector<Shader::UniformInfo> uniforms;              //every active uniform, filled at link time
+    std::unordered_map<std::string, int> uniformLocations;  //name to location
+
+    //only used between submitting and Shader::finish
+    bool pending = false;             //finish() has not run yet
+    bool cached = false;              //program came from ProgramCache, there are no stages
+    unsigned int vertex = 0;          //vertex stage waiting to be checked
+    unsigned int fragment = 0;        //fragment stage waiting to be checked
+    std::string vertexCode;           //kept for ProgramCache::store
+    std::string fragmentCode;         //kept for ProgramCache::store
+    float submitMilliseconds = 0.f;   //main thread time spent submitting
+};
+
+struct TextureResource
+{
+    unsigned int texture; //owned, deleted on collect
+    int width;
+    int height;
+};
+
+typedef ResourcePool<TextureResource>::Handle TextureHandle;
+
+class Resources
+{
+public:
+    Resources(); //becomes current(), Engine makes it before anything builds a Mesh or Shader
+    ~Resources(); //destroys everything still alive, needs the GL context
+
+    Resources(const Resources&) = delete;
+    Resources& operator=(const Resources&) = delete;
+
+    //the pools Mesh and Shader live in, valid between Engine::Initialize and ~Engine
+    static Resources& current();
+
+    //each takes ownership of the GL objects, a full pool deletes them and returns an invalid handle
+    MeshHandle addMesh(const MeshResource& mesh);
+    ShaderHandle addShader(ShaderResource shader);
+    TextureHandle addTexture(unsigned int texture, int width, int height);
+
+    //null when the handle is stale
+    const MeshResource* get(MeshHandle handle) const;
+    const ShaderResource* get(ShaderHandle handle) const;
+    const TextureResource* get(TextureHandle handle) const;
+    ShaderResource* get(ShaderHandle handle); //Shader finishes and caches through this
+
+    //destroyed on the next collect(), until then the handle still works
+    void release(MeshHandle handle);
+    void release(ShaderHandle handle);
+    void release(TextureHandle handle);
+
+    //destroys everything released, Engine calls this once the frame is submitted
+    void collect();
+
+    //gettors
+    size_t meshCount() const;
+    size_t shaderCount() const;
+    size_t textureCount() const;
+    size_t pendingCount() const;
+
+private:
+    static Resources* current_; // the live instance, null outside the engine's lifetime
+
+    ResourcePool<MeshResource> meshes_;
+    ResourcePool<ShaderResource> shaders_;
+    ResourcePool<TextureResource> textures_;
+};
@@ -11,119 +11,258 @@
 #include <sstream>
 #include <iostream>
 #include "Shader.h"
+#include "Resources.h"
+#include "GLState.h"
+#include "SharedUniforms.h"
+#include "ProgramCache.h"
+#include "ShaderPreprocessor.h"
+#include <chrono>
 
 
 //constructor, this constructs a shader from file, non default
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+Shader::Shader(const char* vertexPath, const char* fragmentPath, bool deferred) :
+    Shader(vertexPath, fragmentPath, std::vector<std::string>(), deferred)
 {
-    data_ = std::make_shared<data>();
-    //retrieve the vertex/fragment source code from filePath
+}
+
+//constructor, builds one variant of the files with the given defines
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines,
+    bool deferred)
+{
+    ShaderResource shader;
+    //retrieve the vertex/fragment source code from filePath, includes expanded
     //strings to hold shader code
     std::string vertexCode;
     std::string fragmentCode;
-   
-    //input files for code
-    std::ifstream vertShaderFile;
-    std::ifstream fragShaderFile;
+    ShaderPreprocessor::process(vertexPath, defines, vertexCode);
+    ShaderPreprocessor::process(fragmentPath, defines, fragmentCode);
 
-    // make sure ifstream objects can throw exceptions with failbit/ badbit
-    vertShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fragShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    //time spent on this thread, binaries and compiles are reported separately
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-    try
+    // a stored binary skips compiling and linking entirely
+    shader.program = glCreateProgram();
+    shader.cached = ProgramCache::load(shader.program, vertexCode, fragmentCode);
+    if (!shader.cached)
     {
-        // open files using given path names
-        vertShaderFile.open(vertexPath);
-        fragShaderFile.open(fragmentPath);
-        std::stringstream vertShaderStream, fragShaderStream;
-        // read file's buffer contents into streams
-        vertShaderStream << vertShaderFile.rdbuf();
-        fragShaderStream << fragShaderFile.rdbuf();
-        // close file handlers
-        vertShaderFile.close();
-        fragShaderFile.close();
-        // convert stream into string
-        vertexCode = vertShaderStream.str();
-        fragmentCode = fragShaderStream.str();
-    }
-    catch (std::ifstream::failure& e)
-    {
-        e;
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        //a refused binary leaves the program empty, so it can still be linked from source
+        compileAndLink(shader, vertexCode, fragmentCode);
+        shader.vertexCode = std::move(vertexCode);
+        shader.fragmentCode = std::move(fragmentCode);
     }
+
+    shader.submitMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    shader.pending = true;
+
+    shader.vertexPath = vertexPath;
+    shader.fragmentPath = fragmentPath;
+    shader.defines = defines;
+
+    //the pool owns the program from here on
+    handle_ = Resources::current().addShader(std::move(shader));
+
+    if (!deferred)
+        finish();
+}
+
+//starts both stages and the link, the driver may run these on its own threads.
+//asking for a status here would wait for it, so finish() does the checking
+void Shader::compileAndLink(ShaderResource& shader, const std::string& vertexCode, const std::string& fragmentCode)
+{
     //create const strings for shader code
     const char* vertShaderCode = vertexCode.c_str();
     const char* fragShaderCode = fragmentCode.c_str();
 
-    // compile shaders
-    unsigned int vertex;
-    unsigned int fragment;
-
     // vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vertShaderCode, NULL);
-    glCompileShader(vertex);
+    shader.vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(shader.vertex, 1, &vertShaderCode, NULL);
+    glCompileShader(shader.vertex);
 
-    //use helper to check for compile/link errors
-    checkCompileErrors(vertex, "VERTEX");
     // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fragShaderCode, NULL);
-    glCompileShader(fragment);
-    //use helper to check for compile/link errors
-    checkCompileErrors(fragment, "FRAGMENT");
+    shader.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(shader.fragment, 1, &fragShaderCode, NULL);
+    glCompileShader(shader.fragment);
+
+    // shader Program, the binary hint lets ProgramCache read it back
+    glAttachShader(shader.program, shader.vertex);
+    glAttachShader(shader.program, shader.fragment);
+    if (ProgramCache::isSupported())
+        glProgramParameteri(shader.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(shader.program);
+}
+
+//first status query, this is where the driver is waited on
+void Shader::finish() const
+{
+    ShaderResource* shader = resource();
+    if (!shader || !shader->pending)
+        return;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if (!shader->cached)
+    {
+        //use helper to check for compile/link errors
+        checkCompileErrors(shader->vertex, "VERTEX");
+        checkCompileErrors(shader->fragment, "FRAGMENT");
+        checkCompileErrors(shader->program, "PROGRAM");
+
+        // delete the shaders as they're linked into our program now and no longer necessary
+        glDeleteShader(shader->vertex);
+        glDeleteShader(shader->fragment);
+        shader->vertex = 0;
+        shader->fragment = 0;
 
-    // shader Program
-    data_->ID = glCreateProgram();
-    glAttachShader(data_->ID, vertex);
-    glAttachShader(data_->ID, fragment);
-    glLinkProgram(data_->ID);
-    //use helper to check for compile/link errors
-    checkCompileErrors(data_->ID, "PROGRAM");
+        ProgramCache::store(shader->program, shader->vertexCode, shader->fragmentCode);
+        std::string().swap(shader->vertexCode);
+        std::string().swap(shader->fragmentCode);
+    }
+
+    shader->pending = false;
+    reflectUniforms(*shader);
+    SharedUniforms::bindBlocks(shader->program);
+    shader->modelLocation = findUniform("model");
 
-    data_->vertShaderPath_ = vertexPath;
-    data_->fragShaderPath_ = fragmentPath;
-    // delete the shaders as they're linked into our program now and no longer necessary
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ProgramCache::record(shader->cached, shader->submitMilliseconds + milliseconds);
+}
 
-    data_->modelLocation = glGetUniformLocation(data_->ID, "model");
+//without the extension there is no way to ask, so a pending shader is never ready.
+//a binary from ProgramCache was already checked when it was loaded, nothing is left to wait for
+bool Shader::isReady() const
+{
+    const ShaderResource* shader = resource();
+    if (!shader || !shader->pending || shader->cached)
+        return true;
 
+    if (!GLAD_GL_KHR_parallel_shader_compile)
+        return false;
+
+    int complete = 0;
+    glGetProgramiv(shader->program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete != 0;
 }
 
-//default dtor, frees shader
-Shader::data::~data()
+bool Shader::isPending() const
 {
-    //free memory
-    glDeleteProgram(ID);
+    const ShaderResource* shader = resource();
+    return shader && shader->pending;
 }
 
 //use the current shader
-void Shader::use()
+void Shader::use() const
 {
-    glUseProgram(data_->ID);
+    finish();
+    GLState::useProgram(getID());
 }
 
 //gettor for the vertex shader path
 std::string Shader::getVertPath(void) const
 {
-    return data_->vertShaderPath_;
+    const ShaderResource* shader = resource();
+    return shader ? shader->vertexPath : std::string();
 }
 
 //gettor for fragment shader path.
 std::string Shader::getFragPath(void) const
 {
-    return data_->fragShaderPath_;
+    const ShaderResource* shader = resource();
+    return shader ? shader->fragmentPath : std::string();
+}
+
+const std::vector<std::string>& Shader::getDefines() const
+{
+    static const std::vector<std::string> none;
+    const ShaderResource* shader = resource();
+    return shader ? shader->defines : none;
 }
 
 unsigned int Shader::getModelLoc() const
 {
-    return data_->modelLocation;
+    finish();
+    const ShaderResource* shader = resource();
+    return shader ? shader->modelLocation : 0;
 }
 
+//0 once the shader was released and collected, glUseProgram(0) draws nothing
 unsigned int Shader::getID() const
 {
-    return data_->ID;
+    const ShaderResource* shader = resource();
+    return shader ? shader->program : 0;
+}
+
+ShaderHandle Shader::getHandle() const
+{
+    return handle_;
+}
+
+const std::vector<Shader::UniformInfo>& Shader::getUniforms() const
+{
+    static const std::vector<UniformInfo> none;
+    finish();
+    const ShaderResource* shader = resource();
+    return shader ? shader->uniforms : none;
+}
+
+ShaderResource* Shader::resource() const
+{
+    return Resources::current().get(handle_);
+}
+
+//asks the driver for every active uniform once, so setting them later never has to
+void Shader::reflectUniforms(ShaderResource& shader)
+{
+    int count = 0;
+    int maxLength = 0;
+    glGetProgramiv(shader.program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(shader.program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> nameBuffer(maxLength > 0 ? maxLength : 1);
+    shader.uniforms.clear();
+    shader.uniformLocations.clear();
+
+    for (int i = 0; i < count; ++i)
+    {
+        UniformInfo info;
+        int length = 0;
+        glGetActiveUniform(shader.program, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &info.size,
+            &info.type, nameBuffer.data());
+        info.name.assign(nameBuffer.data(), length);
+
+        //uniforms inside blocks have no location, they are set through the block
+        info.location = glGetUniformLocation(shader.program, info.name.c_str());
+        if (info.location < 0)
+            continue;
+
+        //arrays come back as "name[0]", allow both spellings. Only a trailing [0] goes,
+        //"lights[0].color" is a member of one struct element and keeps its full name
+        shader.uniformLocations[info.name] = info.location;
+        if (info.name.size() >= 3 && info.name.compare(info.name.size() - 3, 3, "[0]") == 0)
+        {
+            info.name.erase(info.name.size() - 3);
+            shader.uniformLocations[info.name] = info.location;
+        }
+
+        shader.uniforms.push_back(info);
+    }
+}
+
+//location from the cache, -1 when the program has no such uniform.
+//array elements past [0] are not reflected, they are asked for once and remembered
+int Shader::findUniform(const std::string& name) const
+{
+    finish();
+    ShaderResource* shader = resource();
+    if (!shader)
+        return -1;
+
+    auto found = shader->uniformLocations.find(name);
+    if (found != shader->uniformLocations.end())
+        return found->second;
+
+    int location = glGetUniformLocation(shader->program, name.c_str());
+    shader->uniformLocations[name] = location;
+    return location;
 }
 
 //check for shader link and compile errors
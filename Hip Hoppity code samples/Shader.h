@@ -16,56 +16,150 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
-#include <memory> //shared pointer
+#include <vector>
+#include "ResourcePool.h"
 
+struct ShaderResource; //Resources.h
+typedef ResourcePool<ShaderResource>::Handle ShaderHandle;
+
+//a handle into Resources, copies refer to the same program and nothing is freed
+//until the handle is released there and collected. Whoever constructs a Shader
+//releases it once done, ShaderLibrary does that for every shader it made
 class Shader
 {
 public:
+  Shader() = default; //empty handle, for members assigned later
 
   //constructor from files for vertex and frament shaders (non default)
-  Shader(const char* vertexPath, const char* fragmentPath);
+  //deferred only submits the compile, status is checked on first use or finish()
+  Shader(const char* vertexPath, const char* fragmentPath, bool deferred = false);
+
+  //same, with "#define X" injected for every entry, entries are "NAME" or "NAME VALUE".
+  //both files are run through ShaderPreprocessor so #include works either way
+  Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines,
+      bool deferred = false);
+
+  void use() const; //use the ID associated with shader
 
-  void use(); //use the ID associated with shader
+  //waits for the driver if needed, reports errors and reflects uniforms. Safe to call again
+  void finish() const;
+  //true once finish() would not wait, only ever false for deferred shaders compiled from source
+  bool isReady() const;
+  bool isPending() const; //submitted but finish() has not run yet
 
   //gettors for path strings for imgui
   std::string getVertPath(void) const;
   std::string getFragPath(void) const;
+  const std::vector<std::string>& getDefines() const;
   unsigned int getModelLoc() const;
   unsigned int getID() const;
+  ShaderHandle getHandle() const;
+
+  //typed handle to one uniform, resolve it once with getUniform and keep it.
+  //setting through a handle never looks anything up
+  template <typename T>
+  class Uniform
+  {
+  public:
+      bool isValid() const { return location >= 0; }
 
-  // utility uniform functions, taken from learnOpenGL
+  private:
+      friend class Shader;
+      int location = -1; //-1 is ignored by glUniform*, same as an unknown name
+  };
+
+  //looks the name up in the uniforms reflected at link time
+  template <typename T>
+  Uniform<T> getUniform(const std::string& name) const
+  {
+      Uniform<T> handle;
+      handle.location = findUniform(name);
+      return handle;
+  }
+
+  void set(Uniform<bool> uniform, bool value) const { glUniform1i(uniform.location, (int)value); }
+  void set(Uniform<int> uniform, int value) const { glUniform1i(uniform.location, value); }
+  void set(Uniform<float> uniform, float value) const { glUniform1f(uniform.location, value); }
+  void set(Uniform<glm::vec2> uniform, const glm::vec2& value) const { glUniform2f(uniform.location, value.x, value.y); }
+  void set(Uniform<glm::vec3> uniform, const glm::vec3& value) const { glUniform3f(uniform.location, value.x, value.y, value.z); }
+  void set(Uniform<glm::vec4> uniform, const glm::vec4& value) const { glUniform4f(uniform.location, value.x, value.y, value.z, value.w); }
+  void set(Uniform<glm::mat3> uniform, const glm::mat3& value) const { glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &value[0][0]); }
+  void set(Uniform<glm::mat4> uniform, const glm::mat4& value) const { glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &value[0][0]); }
+
+  // utility uniform functions, taken from learnOpenGL.
+  // these use the reflected cache instead of asking the driver every call
   // ------------------------------------------------------------------------
   void setBool(const std::string& name, bool value) const
   {
-      glUniform1i(glGetUniformLocation(data_->ID, name.c_str()), (int)value);
+      glUniform1i(findUniform(name), (int)value);
   }
   // ------------------------------------------------------------------------
   void setInt(const std::string& name, int value) const
   {
-      glUniform1i(glGetUniformLocation(data_->ID, name.c_str()), value);
+      glUniform1i(findUniform(name), value);
   }
   // ------------------------------------------------------------------------
   void setFloat(const std::string& name, float value) const
   {
-      glUniform1f(glGetUniformLocation(data_->ID, name.c_str()), value);
+      glUniform1f(findUniform(name), value);
+  }
+  // ------------------------------------------------------------------------
+  void setVec2(const std::string& name, const glm::vec2& value) const
+  {
+      glUniform2f(findUniform(name), value.x, value.y);
+  }
+  // ------------------------------------------------------------------------
+  void setVec3(const std::string& name, const glm::vec3& value) const
+  {
+      glUniform3f(findUniform(name), value.x, value.y, value.z);
+  }
+  // ------------------------------------------------------------------------
+  void setVec4(const std::string& name, const glm::vec4& value) const
+  {
+      glUniform4f(findUniform(name), value.x, value.y, value.z, value.w);
+  }
+  // ------------------------------------------------------------------------
+  void setMat3(const std::string& name, const glm::mat3& value) const
+  {
+      glUniformMatrix3fv(findUniform(name), 1, GL_FALSE, &value[0][0]);
+  }
+  // ------------------------------------------------------------------------
+  void setMat4(const std::string& name, const glm::mat4& value) const
+  {
+      glUniformMatrix4fv(findUniform(name), 1, GL_FALSE, &value[0][0]);
   }
 
+  //one active uniform as reported by the driver after linking
+  struct UniformInfo
+  {
+      std::string name; // name without a trailing [0] for arrays
+      int location;     // what glGetUniformLocation returned
+      GLenum type;      // GL_FLOAT_VEC3, GL_SAMPLER_2D, ...
+      int size;         // array length, 1 for non arrays
+  };
+
+  const std::vector<UniformInfo>& getUniforms() const;
+
 
 private:
+  //starts compiling both stages and linking them into shader.program, nothing is checked here
+  static void compileAndLink(ShaderResource& shader, const std::string& vertexCode,
+      const std::string& fragmentCode);
+
   //check for shader link and compile errors
-  void checkCompileErrors(unsigned int shader, std::string type);
+  static void checkCompileErrors(unsigned int shader, std::string type);
 
-  struct data 
-  {
-      unsigned int ID = 0; //the shaderID attached to this shader
-      unsigned int modelLocation = 0; //used for accessing loc of model matrix
-      std::string vertShaderPath_; // path to the vertex shader 
-      std::string fragShaderPath_; // path to the fragment shader
+  //fills the uniform cache from glGetActiveUniform, called once after linking
+  static void reflectUniforms(ShaderResource& shader);
 
-      ~data();
-  };
+  //location from the cache, -1 when the program has no such uniform
+  //(the cache lives in the pool entry, so lookups that miss can still be remembered)
+  int findUniform(const std::string& name) const;
+
+  //the pool entry, null when the handle is empty or was released and collected
+  ShaderResource* resource() const;
 
-  std::shared_ptr<data> data_;
+  ShaderHandle handle_; //where the program and its state live in Resources
 
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,139 @@
+/*
+ * file: ShaderLibrary.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the ShaderLibrary class,
+ *        this submits shaders together and checks them later.
+ */
+
+#include "ShaderLibrary.h"
+#include "ShaderPreprocessor.h"
+#include "Resources.h"
+#include <glad/glad.h>
+
+/* Use Notes:
+
+    shaders.add("sprite", "shaders/sprite.vert", "shaders/sprite.frag");
+    shaders.add("mesh", "shaders/mesh.vert", "shaders/mesh.frag");
+    ...
+    shaders.sync(); // or keep rendering and let poll()/first use finish them
+
+Specialized variants are built from the same files on first request:
+
+    Shader* fogged = shaders.variant("mesh", { "USE_FOG", "LIGHT_COUNT 4" });
+
+The shader's own code picks paths with #ifdef, so each variant is branch
+free. Only the base shaders are linked at startup.
+
+Errors are still printed by Shader::checkCompileErrors, they just show up at
+the sync point instead of while the shader is being added. Shaders loaded
+from the ProgramCache are ready as soon as they are added.
+
+*/
+
+//0xFFFFFFFF lets the driver pick how many threads to use
+ShaderLibrary::ShaderLibrary()
+{
+    if (isParallel())
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+}
+
+//the library made these, nothing else releases them
+ShaderLibrary::~ShaderLibrary()
+{
+    Resources& resources = Resources::current();
+    for (auto& entry : shaders_)
+        resources.release(entry.second.getHandle());
+    for (auto& entry : variants_)
+        resources.release(entry.second.getHandle());
+}
+
+Shader& ShaderLibrary::add(const std::string& name, const char* vertexPath, const char* fragmentPath)
+{
+    auto found = shaders_.find(name);
+    if (found != shaders_.end())
+        return found->second;
+
+    return shaders_.emplace(name, Shader(vertexPath, fragmentPath, true)).first->second;
+}
+
+Shader* ShaderLibrary::find(const std::string& name)
+{
+    auto found = shaders_.find(name);
+    return found != shaders_.end() ? &found->second : nullptr;
+}
+
+//deferred like everything else, the first use() is what waits for it
+Shader* ShaderLibrary::variant(const std::string& name, const std::vector<std::string>& defines)
+{
+    if (defines.empty())
+        return find(name);
+
+    std::string key = name + "|" + ShaderPreprocessor::keyOf(defines);
+    auto found = variants_.find(key);
+    if (found != variants_.end())
+        return &found->second;
+
+    Shader* base = find(name);
+    if (!base)
+        return nullptr;
+
+    Shader shader(base->getVertPath().c_str(), base->getFragPath().c_str(), defines, true);
+    return &variants_.emplace(key, shader).first->second;
+}
+
+//isReady never waits, so this is safe to call every frame
+unsigned int ShaderLibrary::poll()
+{
+    unsigned int pending = 0;
+
+    for (auto* shaders : { &shaders_, &variants_ })
+    {
+        for (auto& entry : *shaders)
+        {
+            if (!entry.second.isPending())
+                continue;
+
+            if (entry.second.isReady())
+                entry.second.finish();
+            else
+                pending += 1;
+        }
+    }
+
+    return pending;
+}
+
+void ShaderLibrary::sync()
+{
+    for (auto& entry : shaders_)
+        entry.second.finish();
+    for (auto& entry : variants_)
+        entry.second.finish();
+}
+
+//gettors
+
+unsigned int ShaderLibrary::getPendingCount() const
+{
+    unsigned int pending = 0;
+    for (const auto& entry : shaders_)
+        pending += entry.second.isPending() ? 1 : 0;
+    for (const auto& entry : variants_)
+        pending += entry.second.isPending() ? 1 : 0;
+    return pending;
+}
+
+unsigned int ShaderLibrary::getCount() const
+{
+    return (unsigned int)shaders_.size();
+}
+
+unsigned int ShaderLibrary::getVariantCount() const
+{
+    return (unsigned int)variants_.size();
+}
+
+bool ShaderLibrary::isParallel()
+{
+    return GLAD_GL_KHR_parallel_shader_compile != 0;
+}
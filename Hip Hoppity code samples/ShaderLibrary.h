@@ -0,0 +1,50 @@
+/*
+ * file: ShaderLibrary.h
+ * author: Mark Kouris
+ * brief: the interface of the ShaderLibrary class.
+ *        Named shaders that are all submitted before any of them is checked,
+ *        so the driver can compile them side by side instead of one at a time.
+ *        With GL_KHR_parallel_shader_compile the compiles also run on driver
+ *        threads and poll() can pick up finished programs without waiting.
+ *
+ */
+#pragma once
+#include <string>
+#include <unordered_map>
+#include "Shader.h"
+
+class ShaderLibrary
+{
+public:
+    ShaderLibrary(); //hands the driver every thread it wants when the extension is there
+    ~ShaderLibrary(); //releases every shader and variant, Resources collects them
+
+    ShaderLibrary(const ShaderLibrary&) = delete;
+    ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+    //submits the shader and returns right away, adding a name twice keeps the first one
+    Shader& add(const std::string& name, const char* vertexPath, const char* fragmentPath);
+
+    //null when there is no such shader. Using the shader finishes it if it is still pending
+    Shader* find(const std::string& name);
+
+    //the shader added as name, built with these defines. Compiled the first time a
+    //combination is asked for and cached after that, null when name was never added
+    Shader* variant(const std::string& name, const std::vector<std::string>& defines);
+
+    //finishes every program the driver reports done, returns how many are still pending
+    unsigned int poll();
+
+    //explicit sync point, finishes everything that is left
+    void sync();
+
+    //gettors
+    unsigned int getPendingCount() const;
+    unsigned int getCount() const;
+    unsigned int getVariantCount() const;
+    static bool isParallel(); //true when compiles run on driver threads
+
+private:
+    std::unordered_map<std::string, Shader> shaders_;  // every shader by name
+    std::unordered_map<std::string, Shader> variants_; // by name and ShaderPreprocessor::keyOf
+};
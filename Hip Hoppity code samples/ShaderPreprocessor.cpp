@@ -0,0 +1,139 @@
+/*
+ * file: ShaderPreprocessor.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the ShaderPreprocessor class,
+ *        this expands includes and injects defines into GLSL.
+ */
+
+#include "ShaderPreprocessor.h"
+#include <algorithm> // std::sort
+#include <filesystem> // weakly_canonical
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/* Use Notes:
+
+    #version 330 core
+    #include "common/lighting.glsl"   // relative to the file doing the including
+
+Every file is included at most once per program, like #pragma once, which
+also stops include cycles. Files are told apart by their canonical path, so
+"../common/x.glsl" and "x.glsl" from two directories are the same file. "#line" directives around each include keep
+compile errors pointing at the right line of whichever file they are in
+(the file itself is not named, GLSL only takes a number there).
+
+Defines go right after the #version line since nothing but comments is
+allowed before it, that line does not have to be the first one. A UTF-8
+byte order mark at the start of a file is dropped, GLSL compilers reject it.
+
+*/
+
+//helper, directory part of a path including the trailing slash
+static std::string directoryOf(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+//helper, what a file is known by in the include-once set, the path as given if it cannot be resolved
+static std::string canonicalOf(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? path : canonical.string();
+}
+
+bool ShaderPreprocessor::process(const std::string& path, const std::vector<std::string>& defines, std::string& out)
+{
+    std::string expanded;
+    std::unordered_set<std::string> included;
+    bool success = expand(path, included, expanded);
+
+    std::string defineBlock;
+    for (const std::string& define : defines)
+        defineBlock += "#define " + define + "\n";
+
+    //keep #version ahead of everything but the comments before it
+    size_t insertAt = 0;
+    unsigned int lineNumber = 1;
+    for (size_t lineStart = 0; lineStart < expanded.size(); ++lineNumber)
+    {
+        size_t lineEnd = expanded.find('\n', lineStart);
+        size_t nextLine = lineEnd == std::string::npos ? expanded.size() : lineEnd + 1;
+        size_t first = expanded.find_first_not_of(" \t", lineStart);
+
+        if (first < nextLine && expanded.compare(first, 8, "#version") == 0)
+        {
+            insertAt = nextLine;
+            if (!defines.empty())
+                defineBlock += "#line " + std::to_string(lineNumber + 1) + "\n";
+            break;
+        }
+        lineStart = nextLine;
+    }
+
+    out = expanded.substr(0, insertAt) + defineBlock + expanded.substr(insertAt);
+    return success;
+}
+
+std::string ShaderPreprocessor::keyOf(const std::vector<std::string>& defines)
+{
+    std::vector<std::string> sorted = defines;
+    std::sort(sorted.begin(), sorted.end());
+
+    std::string key;
+    for (const std::string& define : sorted)
+        key += define + ";";
+    return key;
+}
+
+bool ShaderPreprocessor::expand(const std::string& path, std::unordered_set<std::string>& included, std::string& out)
+{
+    if (!included.insert(canonicalOf(path)).second)
+        return true;
+
+    std::ifstream inFile(path);
+    if (!inFile.is_open())
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+        return false;
+    }
+
+    bool success = true;
+    std::string line;
+    unsigned int lineNumber = 0;
+
+    while (std::getline(inFile, line))
+    {
+        lineNumber += 1;
+        if (lineNumber == 1 && line.compare(0, 3, "\xEF\xBB\xBF") == 0)
+            line.erase(0, 3);
+
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+        {
+            out += line + "\n";
+            continue;
+        }
+
+        size_t open = line.find('"', start + 8);
+        size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+        if (close == std::string::npos)
+        {
+            std::cout << "ERROR::SHADER::BAD_INCLUDE " << path << ":" << lineNumber << std::endl;
+            success = false;
+            continue;
+        }
+
+        std::string includePath = directoryOf(path) + line.substr(open + 1, close - open - 1);
+        if (included.count(canonicalOf(includePath)))
+            continue;
+
+        out += "#line 1\n";
+        success = expand(includePath, included, out) && success;
+        out += "#line " + std::to_string(lineNumber + 1) + "\n";
+    }
+
+    return success;
+}
@@ -0,0 +1,27 @@
+/*
+ * file: ShaderPreprocessor.h
+ * author: Mark Kouris
+ * brief: the interface of the ShaderPreprocessor class.
+ *        GLSL has no #include, so shader files are expanded here before they
+ *        reach the driver. A list of defines is injected after #version, which
+ *        is how one file turns into several specialized variants.
+ *
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+class ShaderPreprocessor
+{
+public:
+    //reads path, expands every #include "file" and adds "#define X" for every entry in defines.
+    //defines are written as "NAME" or "NAME VALUE". False when any file could not be read
+    static bool process(const std::string& path, const std::vector<std::string>& defines, std::string& out);
+
+    //order independent key for a define list, {"B", "A 2"} and {"A 2", "B"} give the same key
+    static std::string keyOf(const std::vector<std::string>& defines);
+
+private:
+    static bool expand(const std::string& path, std::unordered_set<std::string>& included, std::string& out);
+};
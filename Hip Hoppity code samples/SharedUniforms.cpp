@@ -0,0 +1,78 @@
+/*
+ * file: SharedUniforms.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the SharedUniforms class,
+ *        this uploads shared per frame and per camera uniform blocks.
+ */
+
+#include "SharedUniforms.h"
+
+SharedUniforms::SharedUniforms() : frameBuffer_(FRAME_BINDING), cameraBuffer_(CAMERA_BINDING)
+{
+}
+
+void SharedUniforms::setFrame(float time, float deltaTime, glm::vec2 resolution)
+{
+    frame_.time = time;
+    frame_.deltaTime = deltaTime;
+    frame_.resolution = resolution;
+}
+
+//cameras usually sit still between frames, so skip the upload when nothing moved
+void SharedUniforms::setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position)
+{
+    glm::vec4 position4(position, 1.0f);
+    if (view == camera_.view && projection == camera_.projection && position4 == camera_.cameraPosition)
+        return;
+
+    camera_.view = view;
+    camera_.projection = projection;
+    camera_.viewProjection = projection * view;
+    camera_.cameraPosition = position4;
+    cameraDirty_ = true;
+}
+
+//time changes every frame, the camera only when setCamera saw a change
+void SharedUniforms::upload()
+{
+    frameBuffer_.upload(frame_);
+    uploadCount_ = 1;
+
+    if (cameraDirty_)
+    {
+        cameraBuffer_.upload(camera_);
+        cameraDirty_ = false;
+        ++uploadCount_;
+    }
+}
+
+//gettors
+
+const FrameData& SharedUniforms::getFrame() const
+{
+    return frame_;
+}
+
+const CameraData& SharedUniforms::getCamera() const
+{
+    return camera_;
+}
+
+unsigned int SharedUniforms::getUploadCount() const
+{
+    return uploadCount_;
+}
+
+//blocks a program does not declare come back as GL_INVALID_INDEX and are skipped
+void SharedUniforms::bindBlocks(unsigned int program)
+{
+    const char* names[] = { "FrameData", "CameraData" };
+    const unsigned int bindings[] = { FRAME_BINDING, CAMERA_BINDING };
+
+    for (int i = 0; i < 2; ++i)
+    {
+        unsigned int index = glGetUniformBlockIndex(program, names[i]);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, index, bindings[i]);
+    }
+}
@@ -0,0 +1,127 @@
+/*
+ * file: SharedUniforms.h
+ * author: Mark Kouris
+ * brief: the interface of the SharedUniforms class.
+ *        Per frame and per camera data lives in uniform buffer objects bound
+ *        to fixed binding points, so it is uploaded once per frame instead of
+ *        once per shader. Every Shader binds the blocks it uses at link time.
+ *
+ */
+#pragma once
+#include <glad/glad.h>
+#include "glm/glm/glm.hpp"
+#include <cstddef> // offsetof
+#include "GLState.h"
+
+/* GLSL side, copy into any shader that needs it:
+
+    layout (std140) uniform FrameData
+    {
+        float time;          // seconds since the engine started
+        float deltaTime;     // seconds since the last frame
+        vec2 resolution;     // framebuffer size in pixels
+    };
+
+    layout (std140) uniform CameraData
+    {
+        mat4 view;
+        mat4 projection;
+        mat4 viewProjection;
+        vec4 cameraPosition; // w is unused
+    };
+
+*/
+
+//std140 mirror of FrameData, binding point 0
+struct FrameData
+{
+    float time = 0.f;
+    float deltaTime = 0.f;
+    glm::vec2 resolution = glm::vec2(0);
+};
+
+//std140 mirror of CameraData, binding point 1
+struct CameraData
+{
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::vec4 cameraPosition = glm::vec4(0);
+};
+
+//std140 puts vec2 on 8 byte and vec4/mat4 on 16 byte boundaries, and rounds blocks to 16
+static_assert(offsetof(FrameData, resolution) == 8, "FrameData does not match std140");
+static_assert(sizeof(FrameData) % 16 == 0, "FrameData must be padded to 16 bytes");
+static_assert(offsetof(CameraData, projection) == 64, "CameraData does not match std140");
+static_assert(offsetof(CameraData, viewProjection) == 128, "CameraData does not match std140");
+static_assert(offsetof(CameraData, cameraPosition) == 192, "CameraData does not match std140");
+static_assert(sizeof(CameraData) % 16 == 0, "CameraData must be padded to 16 bytes");
+
+//one uniform buffer holding a T, bound to a fixed binding point for its whole life
+template <typename T>
+class UniformBuffer
+{
+public:
+    UniformBuffer(unsigned int binding) : binding_(binding)
+    {
+        glGenBuffers(1, &UBO);
+        GLState::bindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+        GLState::bindBufferBase(GL_UNIFORM_BUFFER, binding_, UBO);
+    }
+
+    ~UniformBuffer()
+    {
+        glDeleteBuffers(1, &UBO);
+        GLState::forgetBuffer(UBO);
+    }
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    //replaces the whole block, the driver renames the storage if it is still in use
+    void upload(const T& value)
+    {
+        GLState::bindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), &value, GL_DYNAMIC_DRAW);
+    }
+
+    unsigned int getBinding() const { return binding_; }
+
+private:
+    unsigned int UBO = 0;   // the buffer object
+    unsigned int binding_;  // fixed binding point
+};
+
+class SharedUniforms
+{
+public:
+    enum Binding { FRAME_BINDING = 0, CAMERA_BINDING = 1 };
+
+    SharedUniforms();
+
+    //engine side, called once per frame
+    void setFrame(float time, float deltaTime, glm::vec2 resolution);
+
+    //camera side, only uploads when something changed
+    void setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position);
+
+    //uploads whatever changed since the last call, once per frame before rendering
+    void upload();
+
+    //gettors
+    const FrameData& getFrame() const;
+    const CameraData& getCamera() const;
+    unsigned int getUploadCount() const; //buffers uploaded by the last upload()
+
+    //points every known block in this program at its binding, Shader calls this after linking
+    static void bindBlocks(unsigned int program);
+
+private:
+    UniformBuffer<FrameData> frameBuffer_;   // binding 0
+    UniformBuffer<CameraData> cameraBuffer_; // binding 1
+    FrameData frame_;                        // latest frame values
+    CameraData camera_;                      // latest camera values
+    bool cameraDirty_ = true;                // camera_ changed since its last upload
+    unsigned int uploadCount_ = 0;           // buffers uploaded by the last upload()
+};
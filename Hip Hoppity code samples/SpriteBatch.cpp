@@ -0,0 +1,241 @@
+/*
+ * file: SpriteBatch.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the SpriteBatch class,
+ *        this batches sprite quads into a few large draw calls.
+ */
+
+#include "SpriteBatch.h"
+#include "GLState.h"
+#include <algorithm> // std::stable_sort, std::min
+#include <cfloat>    // FLT_MAX
+
+/* Use Notes:
+
+Systems call submit() from their Render(), Engine::Render calls flush() once
+after every system has rendered. Sprites are sorted by layer, then shader,
+then texture. The sort is stable, so sprites with the same key keep the
+order they were submitted in.
+
+The streaming buffer holds 3 frames worth of quads, it is written with
+unsynchronized maps and orphaned when it wraps, so the CPU never waits
+for the GPU to finish with the previous frames.
+
+*/
+
+SpriteBatch::SpriteBatch(unsigned int maxSprites) : maxSprites_(maxSprites),
+    ringVertices_(maxSprites * 4 * FRAMES_IN_FLIGHT)
+{
+    //every quad uses the same 6 indices offset by 4 vertices
+    std::vector<unsigned int> indices(maxSprites_ * 6);
+    for (unsigned int i = 0; i < maxSprites_; ++i)
+    {
+        unsigned int base = i * 4;
+        indices[i * 6 + 0] = base + 0; // first Triangle
+        indices[i * 6 + 1] = base + 1;
+        indices[i * 6 + 2] = base + 3;
+        indices[i * 6 + 3] = base + 1; // second Triangle
+        indices[i * 6 + 4] = base + 2;
+        indices[i * 6 + 5] = base + 3;
+    }
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    GLState::bindVertexArray(VAO);
+
+    //storage only, filled every frame
+    GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, ringVertices_ * sizeof(vertex), NULL, GL_STREAM_DRAW);
+
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+    //position, color and texture coordinate attributes, offsets and stride come from vertex
+    VertexFormat::apply<vertex>();
+
+    GLState::bindVertexArray(0);
+}
+
+SpriteBatch::~SpriteBatch()
+{
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    GLState::forgetVertexArray(VAO);
+    GLState::forgetBuffer(VBO);
+    GLState::forgetBuffer(EBO);
+}
+
+//queues one quad, the corners are transformed here so flush only copies
+void SpriteBatch::submit(const Shader& shader, unsigned int texture, const glm::mat4& transform,
+    glm::vec4 uvRect, glm::vec3 color, unsigned short layer)
+{
+    sprite s;
+    s.shader = shader;
+    s.texture = texture;
+    s.program = shader.getID();
+    s.key = ((unsigned long long)layer << 48) |
+            ((unsigned long long)(s.program & 0xFFFF) << 32) |
+            (unsigned long long)texture;
+
+    //same corner order as Mesh, upper right, bottom right, bottom left, upper left
+    const float cornerX[4] = { 0.5f,  0.5f, -0.5f, -0.5f };
+    const float cornerY[4] = { 0.5f, -0.5f, -0.5f,  0.5f };
+    const float cornerU[4] = { 1.0f,  1.0f,  0.0f,  0.0f };
+    const float cornerV[4] = { 1.0f,  0.0f,  0.0f,  1.0f };
+
+    glm::vec2 min(FLT_MAX);
+    glm::vec2 max(-FLT_MAX);
+
+    const UNorm8x4 tint(color.r, color.g, color.b);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        glm::vec4 world = transform * glm::vec4(cornerX[i], cornerY[i], 0.0f, 1.0f);
+        vertex& v = s.corners[i];
+        v.position = glm::vec3(world);
+        v.color = tint;
+        v.uv = glm::vec2(uvRect.x + cornerU[i] * uvRect.z, uvRect.y + cornerV[i] * uvRect.w);
+
+        min = glm::min(min, glm::vec2(world));
+        max = glm::max(max, glm::vec2(world));
+    }
+
+    if (useBounds_ && (max.x < boundsMin_.x || min.x > boundsMax_.x ||
+                       max.y < boundsMin_.y || min.y > boundsMax_.y))
+    {
+        ++culledSinceFlush_;
+        return;
+    }
+
+    sprites_.push_back(s);
+}
+
+//the batch only draws unit quads, so the mesh contributes its local transform
+void SpriteBatch::submit(const Shader& shader, const Mesh& mesh, unsigned int texture, const glm::mat4& transform,
+    glm::vec4 uvRect, glm::vec3 color, unsigned short layer)
+{
+    submit(shader, texture, transform * mesh.localTransform(), uvRect, color, layer);
+}
+
+void SpriteBatch::setViewBounds(glm::vec2 min, glm::vec2 max)
+{
+    useBounds_ = true;
+    boundsMin_ = min;
+    boundsMax_ = max;
+}
+
+void SpriteBatch::clearViewBounds()
+{
+    useBounds_ = false;
+}
+
+//sorts everything submitted this frame, uploads it and draws it
+void SpriteBatch::flush()
+{
+    drawCalls_ = 0;
+    spriteCount_ = (unsigned int)sprites_.size();
+    culledCount_ = culledSinceFlush_;
+    culledSinceFlush_ = 0;
+
+    if (sprites_.empty())
+        return;
+
+    order_.resize(sprites_.size());
+    for (unsigned int i = 0; i < order_.size(); ++i)
+        order_[i] = i;
+
+    //two programs can share the key's 16 bits, the full name keeps their sprites apart
+    std::stable_sort(order_.begin(), order_.end(), [this](unsigned int a, unsigned int b)
+        {
+            const sprite& left = sprites_[a];
+            const sprite& right = sprites_[b];
+            return left.key != right.key ? left.key < right.key : left.program < right.program;
+        });
+
+    GLState::bindVertexArray(VAO);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
+
+    //walk the sorted list and draw every run of equal keys and programs
+    size_t runStart = 0;
+    for (size_t i = 1; i <= order_.size(); ++i)
+    {
+        if (i < order_.size() && sprites_[order_[i]].key == sprites_[order_[runStart]].key &&
+            sprites_[order_[i]].program == sprites_[order_[runStart]].program)
+            continue;
+
+        const sprite& first = sprites_[order_[runStart]];
+        drawRun(first.shader, first.texture, order_, runStart, i - runStart);
+        runStart = i;
+    }
+
+    GLState::bindVertexArray(0);
+    sprites_.clear();
+}
+
+//draws count sorted sprites starting at first, split into maxSprites_ sized pieces
+void SpriteBatch::drawRun(const Shader& shader, unsigned int texture, const std::vector<unsigned int>& order,
+    size_t first, size_t count)
+{
+    //the vertices are already in world space
+    const glm::mat4 identity(1.0f);
+    shader.use();
+    glUniformMatrix4fv(shader.getModelLoc(), 1, GL_FALSE, &identity[0][0]);
+    GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+
+    while (count > 0)
+    {
+        unsigned int quads = (unsigned int)std::min<size_t>(count, maxSprites_);
+        unsigned int vertexCount = quads * 4;
+
+        //orphan the buffer when it wraps, the driver hands back fresh storage
+        if (ringOffset_ + vertexCount > ringVertices_)
+        {
+            glBufferData(GL_ARRAY_BUFFER, ringVertices_ * sizeof(vertex), NULL, GL_STREAM_DRAW);
+            ringOffset_ = 0;
+        }
+
+        vertex* dest = (vertex*)glMapBufferRange(GL_ARRAY_BUFFER, ringOffset_ * sizeof(vertex),
+            vertexCount * sizeof(vertex),
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+
+        if (dest)
+        {
+            for (unsigned int i = 0; i < quads; ++i)
+            {
+                const vertex* corners = sprites_[order[first + i]].corners;
+                dest[i * 4 + 0] = corners[0];
+                dest[i * 4 + 1] = corners[1];
+                dest[i * 4 + 2] = corners[2];
+                dest[i * 4 + 3] = corners[3];
+            }
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+
+            glDrawElementsBaseVertex(GL_TRIANGLES, quads * 6, GL_UNSIGNED_INT, (void*)0, ringOffset_);
+            ++drawCalls_;
+        }
+
+        ringOffset_ += vertexCount;
+        first += quads;
+        count -= quads;
+    }
+}
+
+//gettors
+
+unsigned int SpriteBatch::getDrawCalls() const
+{
+    return drawCalls_;
+}
+
+unsigned int SpriteBatch::getSpriteCount() const
+{
+    return spriteCount_;
+}
+
+unsigned int SpriteBatch::getCulledCount() const
+{
+    return culledCount_;
+}
@@ -0,0 +1,95 @@
+/*
+ * file: SpriteBatch.h
+ * author: Mark Kouris
+ * brief: the interface of the SpriteBatch class.
+ *        Sprites are submitted during Render, then flush() writes all of their
+ *        transformed quads into one streaming vertex buffer and draws them
+ *        with one call per shader/texture pair instead of one per sprite.
+ *
+ */
+#pragma once
+#include <glad/glad.h>
+#include "glm/glm/glm.hpp"
+#include <vector>
+#include "Shader.h"
+#include "Mesh.h"
+#include "VertexFormat.h"
+
+class SpriteBatch
+{
+public:
+    SpriteBatch(unsigned int maxSprites = 8192); //max sprites drawn by one call
+    ~SpriteBatch();
+
+    SpriteBatch(const SpriteBatch&) = delete;
+    SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+    //queues one unit quad (-0.5 to 0.5) placed by transform, uvRect is x, y, width, height.
+    //color is a 0 to 1 tint, it is stored in 8 bits a channel
+    //lower layers are drawn first, submission order is kept inside a layer/shader/texture
+    void submit(const Shader& shader, unsigned int texture, const glm::mat4& transform,
+        glm::vec4 uvRect = glm::vec4(0, 0, 1, 1), glm::vec3 color = glm::vec3(1.0f),
+        unsigned short layer = 0);
+    //same, for a sprite that has a Mesh, its localTransform places the quad inside transform
+    void submit(const Shader& shader, const Mesh& mesh, unsigned int texture, const glm::mat4& transform,
+        glm::vec4 uvRect = glm::vec4(0, 0, 1, 1), glm::vec3 color = glm::vec3(1.0f),
+        unsigned short layer = 0);
+
+    //sprites whose quad is fully outside these world bounds are dropped on submit
+    void setViewBounds(glm::vec2 min, glm::vec2 max);
+    void clearViewBounds();
+
+    //sorts everything submitted this frame, uploads it and draws it
+    void flush();
+
+    //gettors, these describe the last flush
+    unsigned int getDrawCalls() const;
+    unsigned int getSpriteCount() const;
+    unsigned int getCulledCount() const;
+
+private:
+    static constexpr unsigned int FRAMES_IN_FLIGHT = 3; // frames of quads the streaming buffer holds
+
+    //same locations as the Mesh quads so existing shaders work unchanged, 24 bytes
+    struct vertex
+    {
+        glm::vec3 position; //location 0, world space
+        UNorm8x4 color;     //location 1
+        glm::vec2 uv;       //location 2, floats so atlas rects keep full precision
+
+        static constexpr std::array<VertexAttribute, 3> layout()
+        {
+            return {{ VERTEX_ATTRIBUTE(vertex, position, 0),
+                      VERTEX_ATTRIBUTE(vertex, color, 1),
+                      VERTEX_ATTRIBUTE(vertex, uv, 2) }};
+        }
+    };
+
+    struct sprite
+    {
+        unsigned long long key;  // layer, then low 16 bits of the program, then texture
+        unsigned int program;    // full program name, breaks ties between programs the key can't tell apart
+        Shader shader;           // shader to draw with, a handle
+        unsigned int texture;    // texture bound on unit 0
+        vertex corners[4];       // already transformed into world space
+    };
+
+    void drawRun(const Shader& shader, unsigned int texture, const std::vector<unsigned int>& order,
+        size_t first, size_t count);
+
+    std::vector<sprite> sprites_;         // everything submitted since the last flush
+    std::vector<unsigned int> order_;     // sprites_ indices sorted by key
+    unsigned int maxSprites_;             // how many quads fit in one draw
+    unsigned int ringVertices_;           // size of the streaming buffer in vertices
+    unsigned int ringOffset_ = 0;         // next free vertex in the streaming buffer
+    unsigned int VAO = 0;                 // layout for the streaming buffer
+    unsigned int VBO = 0;                 // streaming vertex buffer
+    unsigned int EBO = 0;                 // static quad indices for maxSprites quads
+    bool useBounds_ = false;              // whether view bounds culling is on
+    glm::vec2 boundsMin_ = glm::vec2(0);  // min corner of the view bounds
+    glm::vec2 boundsMax_ = glm::vec2(0);  // max corner of the view bounds
+    unsigned int drawCalls_ = 0;          // draws issued by the last flush
+    unsigned int spriteCount_ = 0;        // sprites drawn by the last flush
+    unsigned int culledCount_ = 0;        // sprites dropped since the last flush
+    unsigned int culledSinceFlush_ = 0;   // running count for the current frame
+};
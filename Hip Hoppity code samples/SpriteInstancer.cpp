@@ -0,0 +1,220 @@
+/*
+ * file: SpriteInstancer.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the SpriteInstancer class,
+ *        this draws sprite groups with glDrawElementsInstancedBaseInstance.
+ */
+
+#include "SpriteInstancer.h"
+#include "MeshRegistry.h"
+#include "GLState.h"
+#include <iostream>
+
+/* Use Notes:
+
+The instance buffer is split into three frames, and each frame is laid out
+as separate arrays (all transforms, then all uv rects, then all tints),
+so a Range can be filled by several threads without sharing cache lines
+between fields:
+
+    | transforms f0 | transforms f1 | transforms f2 | uvs f0 | ... | tints f2 |
+
+Shaders drawn through this path read the quad from locations 0-2 like every
+other Mesh, plus the per instance data:
+    layout (location = 3) in mat4 instanceModel;   // uses locations 3 to 6
+    layout (location = 7) in vec4 instanceUV;      // x, y, width, height
+    layout (location = 8) in vec4 instanceTint;
+
+*/
+
+#define FENCE_TIMEOUT 1000000000 //one second in nanoseconds
+
+SpriteInstancer::SpriteInstancer(unsigned int maxInstances) :
+    quad_(MeshRegistry::unitQuad()), maxInstances_(maxInstances)
+{
+    //groups are drawn with glDrawElementsInstancedBaseInstance, core only since 4.2
+    supported_ = (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) &&
+                 (GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_base_instance);
+    if (!supported_)
+    {
+        std::cout << "SpriteInstancer: buffer storage or base instance not supported, use SpriteBatch" << std::endl;
+        return;
+    }
+
+    const GLsizeiptr slots = (GLsizeiptr)maxInstances_ * FRAMES_IN_FLIGHT;
+    const GLsizeiptr bytes = slots * (sizeof(glm::mat4) + 2 * sizeof(glm::vec4));
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &instanceBuffer);
+
+    GLState::bindVertexArray(VAO);
+
+    //same quad and layout as the Mesh
+    GLState::bindBuffer(GL_ARRAY_BUFFER, quad_.getVBO());
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_.getEBO());
+
+    VertexFormat::apply<Mesh::Vertex>();
+
+    //storage is immutable so it can stay mapped for the life of the buffer
+    GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferStorage(GL_ARRAY_BUFFER, bytes, NULL, flags);
+    mapped_ = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+
+    const size_t uvOffset = slots * sizeof(glm::mat4);
+    const size_t tintOffset = uvOffset + slots * sizeof(glm::vec4);
+
+    //model matrix takes 4 locations, one per column
+    for (unsigned int column = 0; column < 4; ++column)
+    {
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+            (void*)(column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(3 + column, 1);
+        glEnableVertexAttribArray(3 + column);
+    }
+
+    //uv rect attribute
+    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)uvOffset);
+    glVertexAttribDivisor(7, 1);
+    glEnableVertexAttribArray(7);
+
+    //tint attribute
+    glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)tintOffset);
+    glVertexAttribDivisor(8, 1);
+    glEnableVertexAttribArray(8);
+
+    GLState::bindVertexArray(0);
+
+    if (!mapped_)
+    {
+        std::cout << "ERROR::SPRITE_INSTANCER::MAP_FAILED" << std::endl;
+        supported_ = false;
+    }
+}
+
+SpriteInstancer::~SpriteInstancer()
+{
+    for (GLsync& fence : fences_)
+    {
+        if (fence)
+            glDeleteSync(fence);
+    }
+
+    if (instanceBuffer)
+    {
+        GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glDeleteBuffers(1, &instanceBuffer);
+        GLState::forgetBuffer(instanceBuffer);
+    }
+
+    glDeleteVertexArrays(1, &VAO);
+    GLState::forgetVertexArray(VAO);
+}
+
+bool SpriteInstancer::isSupported() const
+{
+    return supported_;
+}
+
+//moves to the next third of the buffer, waits only if the GPU is 3 frames behind
+void SpriteInstancer::beginFrame()
+{
+    frame_ = (frame_ + 1) % FRAMES_IN_FLIGHT;
+    used_ = 0;
+    groups_.clear();
+
+    GLsync& fence = fences_[frame_];
+    if (!fence)
+        return;
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        ++stallCount_;
+        while (result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+//reserves count instances, the caller fills the arrays
+SpriteInstancer::Range SpriteInstancer::reserve(const Shader& shader, unsigned int texture, unsigned int count)
+{
+    Range range;
+    if (!supported_ || used_ >= maxInstances_)
+        return range;
+
+    if (count > maxInstances_ - used_)
+        count = maxInstances_ - used_;
+
+    const size_t slots = (size_t)maxInstances_ * FRAMES_IN_FLIGHT;
+    const size_t index = (size_t)frame_ * maxInstances_ + used_;
+
+    glm::mat4* transforms = (glm::mat4*)mapped_;
+    glm::vec4* uvRects = (glm::vec4*)(mapped_ + slots * sizeof(glm::mat4));
+    glm::vec4* tints = uvRects + slots;
+
+    range.transforms = transforms + index;
+    range.uvRects = uvRects + index;
+    range.tints = tints + index;
+    range.count = count;
+
+    //groups reserved back to back with the same state share one draw
+    if (!groups_.empty() && groups_.back().shader.getHandle() == shader.getHandle() &&
+        groups_.back().texture == texture)
+        groups_.back().count += count;
+    else
+        groups_.push_back({ shader, texture, used_, count });
+
+    used_ += count;
+    return range;
+}
+
+//draws every reserved group and fences this part of the buffer
+void SpriteInstancer::endFrame()
+{
+    drawCalls_ = 0;
+    instanceCount_ = used_;
+
+    if (!supported_ || groups_.empty())
+        return;
+
+    //the transform comes from the instance data
+    const glm::mat4 identity(1.0f);
+
+    GLState::bindVertexArray(VAO);
+
+    for (const group& g : groups_)
+    {
+        g.shader.use();
+        glUniformMatrix4fv(g.shader.getModelLoc(), 1, GL_FALSE, &identity[0][0]);
+        GLState::bindTexture(0, GL_TEXTURE_2D, g.texture);
+
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, quad_.indiciesCount(), GL_UNSIGNED_INT,
+            (void*)0, g.count, frame_ * maxInstances_ + g.first);
+        ++drawCalls_;
+    }
+
+    GLState::bindVertexArray(0);
+    fences_[frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+//gettors
+
+unsigned int SpriteInstancer::getDrawCalls() const
+{
+    return drawCalls_;
+}
+
+unsigned int SpriteInstancer::getInstanceCount() const
+{
+    return instanceCount_;
+}
+
+unsigned int SpriteInstancer::getStallCount() const
+{
+    return stallCount_;
+}
@@ -0,0 +1,79 @@
+/*
+ * file: SpriteInstancer.h
+ * author: Mark Kouris
+ * brief: the interface of the SpriteInstancer class.
+ *        Draws every sprite that shares a shader and texture with one instanced
+ *        call on the shared unit quad. Instance data lives in a triple buffered,
+ *        persistently mapped buffer guarded by fences, so the CPU writes straight
+ *        into GPU visible memory and never waits on frames still in flight.
+ *
+ */
+#pragma once
+#include <glad/glad.h>
+#include "glm/glm/glm.hpp"
+#include <vector>
+#include "Mesh.h"
+#include "Shader.h"
+
+class SpriteInstancer
+{
+public:
+    //one group of instances, each array holds count entries and can be filled
+    //from any thread until endFrame() is called
+    struct Range
+    {
+        glm::mat4* transforms = nullptr; // model matrix for the unit quad
+        glm::vec4* uvRects = nullptr;    // x, y, width, height in texture space
+        glm::vec4* tints = nullptr;      // multiplied with the texture color
+        unsigned int count = 0;          // how many instances were reserved
+    };
+
+    SpriteInstancer(unsigned int maxInstances = 16384); //max instances per frame
+    ~SpriteInstancer();
+
+    SpriteInstancer(const SpriteInstancer&) = delete;
+    SpriteInstancer& operator=(const SpriteInstancer&) = delete;
+
+    //needs GL 4.4 buffer storage and 4.2 base instance, when false use the SpriteBatch instead
+    bool isSupported() const;
+
+    //moves to the next third of the buffer, waits only if the GPU is 3 frames behind
+    void beginFrame();
+
+    //reserves count instances drawn with this shader and texture,
+    //the range is shorter than asked for when the frame is full
+    Range reserve(const Shader& shader, unsigned int texture, unsigned int count);
+
+    //draws every reserved group and fences this part of the buffer
+    void endFrame();
+
+    //gettors, these describe the last frame
+    unsigned int getDrawCalls() const;
+    unsigned int getInstanceCount() const;
+    unsigned int getStallCount() const; //total times beginFrame had to wait
+
+private:
+    static constexpr unsigned int FRAMES_IN_FLIGHT = 3; // thirds of the instance buffer, and fences guarding them
+
+    struct group
+    {
+        Shader shader;         // shader to draw with, a handle
+        unsigned int texture;  // texture bound on unit 0
+        unsigned int first;    // first instance inside this frame
+        unsigned int count;    // how many instances
+    };
+
+    Mesh quad_;                          // the shared unit quad from the MeshRegistry
+    std::vector<group> groups_;          // reserved this frame, in draw order
+    unsigned int maxInstances_;          // instances per frame
+    unsigned int frame_ = 0;             // which third of the buffer is being written
+    unsigned int used_ = 0;              // instances reserved this frame
+    unsigned int VAO = 0;                // unit quad plus the instance attributes
+    unsigned int instanceBuffer = 0;     // the persistently mapped buffer
+    unsigned char* mapped_ = nullptr;    // start of the mapping
+    GLsync fences_[FRAMES_IN_FLIGHT] = {}; // one fence per third of the buffer
+    bool supported_ = false;             // whether buffer storage and base instance were available
+    unsigned int drawCalls_ = 0;         // draws issued last frame
+    unsigned int instanceCount_ = 0;     // instances drawn last frame
+    unsigned int stallCount_ = 0;        // how often beginFrame had to wait
+};
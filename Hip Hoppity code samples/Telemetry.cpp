@@ -0,0 +1,261 @@
+/*
+ * file: Telemetry.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the Telemetry class,
+ *        this aggregates system timings and writes/reads the reports.
+ */
+
+#include "Telemetry.h"
+#include <algorithm> // std::sort, std::max
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept> // std::stoul/std::stof throw on bad rows
+
+/* Use Notes:
+
+Report layout (CSV):
+    system,samples,mean,p50,p95,p99,max
+    Physics,600,0.412,0.398,0.511,0.602,0.733
+
+JSON reports hold the same fields and are meant for dashboards,
+the comparison tool only reads CSV.
+
+*/
+
+//helper, nearest rank percentile of an already sorted list
+static float percentile(const std::vector<float>& sorted, float percent)
+{
+    if (sorted.empty())
+        return 0.f;
+
+    size_t rank = (size_t)(percent / 100.f * (float)(sorted.size() - 1) + 0.5f);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+Telemetry::Telemetry(const char* outputPath, Format format, unsigned int windowFrames) :
+    windowFrames_(windowFrames == 0 ? 1 : windowFrames), format_(format), outputPath_(outputPath)
+{
+}
+
+//default dtor, makes sure the report exists on shutdown
+Telemetry::~Telemetry()
+{
+    if (!written_)
+        write();
+}
+
+//add one timing for this frame
+void Telemetry::record(const std::string& system, float milliseconds)
+{
+    channel& chan = findChannel(system);
+
+    if (chan.samples.empty())
+        chan.samples.resize(windowFrames_);
+
+    chan.samples[chan.count % windowFrames_] = milliseconds;
+    chan.count += 1;
+}
+
+//moves the window forward one frame
+void Telemetry::endFrame()
+{
+    frameCount_ += 1;
+    cursor_ = 0;
+}
+
+//computes stats for every system seen so far
+std::vector<Telemetry::Stats> Telemetry::aggregate() const
+{
+    std::vector<Stats> result;
+    std::vector<float> sorted;
+    sorted.reserve(windowFrames_);
+
+    for (const channel& chan : channels_)
+    {
+        unsigned int used = std::min(chan.count, windowFrames_);
+        sorted.assign(chan.samples.begin(), chan.samples.begin() + used);
+        std::sort(sorted.begin(), sorted.end());
+
+        Stats stats;
+        stats.name = chan.name;
+        stats.samples = used;
+
+        double sum = 0.0;
+        for (float sample : sorted)
+            sum += sample;
+
+        stats.mean = used ? (float)(sum / used) : 0.f;
+        stats.p50 = percentile(sorted, 50.f);
+        stats.p95 = percentile(sorted, 95.f);
+        stats.p99 = percentile(sorted, 99.f);
+        stats.max = used ? sorted.back() : 0.f;
+        result.push_back(stats);
+    }
+
+    return result;
+}
+
+//writes the report to the output path
+bool Telemetry::write()
+{
+    std::ofstream outFile(outputPath_);
+    if (!outFile.is_open())
+    {
+        std::cout << "ERROR::TELEMETRY::COULD_NOT_OPEN " << outputPath_ << std::endl;
+        return false;
+    }
+
+    std::vector<Stats> stats = aggregate();
+
+    if (format_ == CSV)
+    {
+        outFile << "system,samples,mean,p50,p95,p99,max\n";
+        for (const Stats& s : stats)
+        {
+            outFile << s.name << ',' << s.samples << ',' << s.mean << ',' << s.p50 << ','
+                    << s.p95 << ',' << s.p99 << ',' << s.max << '\n';
+        }
+    }
+    else
+    {
+        outFile << "{\n  \"frames\": " << frameCount_ << ",\n  \"systems\": [\n";
+        for (size_t i = 0; i < stats.size(); ++i)
+        {
+            const Stats& s = stats[i];
+            outFile << "    { \"name\": \"" << s.name << "\", \"samples\": " << s.samples
+                    << ", \"mean\": " << s.mean << ", \"p50\": " << s.p50
+                    << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99
+                    << ", \"max\": " << s.max << " }" << (i + 1 < stats.size() ? ",\n" : "\n");
+        }
+        outFile << "  ]\n}\n";
+    }
+
+    written_ = true;
+    return true;
+}
+
+//reads a CSV report written by write()
+bool Telemetry::load(const char* path, std::vector<Stats>& stats)
+{
+    std::ifstream inFile(path);
+    if (!inFile.is_open())
+    {
+        std::cout << "ERROR::TELEMETRY::COULD_NOT_OPEN " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    std::getline(inFile, line); //skip the column names
+
+    while (std::getline(inFile, line))
+    {
+        if (line.empty())
+            continue;
+
+        std::stringstream lineStream(line);
+        std::string field;
+        Stats s;
+
+        //a hand edited or cut off report must fail the gate, not pass or crash it
+        try
+        {
+            std::getline(lineStream, s.name, ',');
+            std::getline(lineStream, field, ','); s.samples = (unsigned int)std::stoul(field);
+            std::getline(lineStream, field, ','); s.mean = std::stof(field);
+            std::getline(lineStream, field, ','); s.p50 = std::stof(field);
+            std::getline(lineStream, field, ','); s.p95 = std::stof(field);
+            std::getline(lineStream, field, ','); s.p99 = std::stof(field);
+            std::getline(lineStream, field, ','); s.max = std::stof(field);
+        }
+        catch (const std::exception&)
+        {
+            std::cout << "ERROR::TELEMETRY::BAD_ROW " << path << ": " << line << std::endl;
+            return false;
+        }
+        stats.push_back(s);
+    }
+
+    return true;
+}
+
+//compares current against baseline, returns how many systems regressed
+int Telemetry::compare(const std::vector<Stats>& baseline, const std::vector<Stats>& current,
+    float thresholdPercent)
+{
+    int regressions = 0;
+
+    for (const Stats& base : baseline)
+    {
+        const Stats* found = nullptr;
+        for (const Stats& now : current)
+        {
+            if (now.name == base.name)
+            {
+                found = &now;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            std::cout << "REGRESSION " << base.name << " missing from the current report" << std::endl;
+            regressions += 1;
+            continue;
+        }
+
+        //tiny timings are mostly noise, so give them a small absolute floor
+        float limit = std::max(base.p95 * (1.f + thresholdPercent / 100.f), base.p95 + 0.01f);
+        if (found->p95 > limit)
+        {
+            std::cout << "REGRESSION " << base.name << " p95 " << base.p95 << " -> " << found->p95
+                      << " ms (limit " << limit << ")" << std::endl;
+            regressions += 1;
+        }
+    }
+
+    return regressions;
+}
+
+//gettors
+
+unsigned int Telemetry::getFrameCount() const
+{
+    return frameCount_;
+}
+
+unsigned int Telemetry::getWindowFrames() const
+{
+    return windowFrames_;
+}
+
+Telemetry::Format Telemetry::getFormat() const
+{
+    return format_;
+}
+
+std::string Telemetry::getOutputPath() const
+{
+    return outputPath_;
+}
+
+//systems are timed in the same order every frame, so check the expected one first
+Telemetry::channel& Telemetry::findChannel(const std::string& system)
+{
+    if (cursor_ < channels_.size() && channels_[cursor_].name == system)
+        return channels_[cursor_++];
+
+    for (unsigned int i = 0; i < channels_.size(); ++i)
+    {
+        if (channels_[i].name == system)
+        {
+            cursor_ = i + 1;
+            return channels_[i];
+        }
+    }
+
+    channels_.push_back(channel());
+    channels_.back().name = system;
+    cursor_ = (unsigned int)channels_.size();
+    return channels_.back();
+}
@@ -0,0 +1,73 @@
+/*
+ * file: Telemetry.h
+ * author: Mark Kouris
+ * brief: the interface of the Telemetry class.
+ *      This is an opt-in sink for the per system timings measured in
+ *      Engine::Update. It keeps the last N frames of every system and
+ *      writes mean, percentiles and max to a CSV or JSON file on shutdown.
+ *
+ */
+#pragma once
+#include <string> // system names and output path
+#include <vector> // per system sample windows
+
+class Telemetry
+{
+public:
+    enum Format { CSV, JSON };
+
+    //aggregated numbers for one system, all times are in milliseconds
+    struct Stats
+    {
+        std::string name;
+        unsigned int samples = 0;
+        float mean = 0.f;
+        float p50 = 0.f;
+        float p95 = 0.f;
+        float p99 = 0.f;
+        float max = 0.f;
+    };
+
+    Telemetry(const char* outputPath, Format format = CSV, unsigned int windowFrames = 600);
+    ~Telemetry(); //writes the report if it has not been written yet
+
+    void record(const std::string& system, float milliseconds); //add one timing for this frame
+    void endFrame(); //moves the window forward one frame
+
+    std::vector<Stats> aggregate() const; //computes stats for every system seen so far
+    bool write(); //writes the report to the output path
+
+    //gettors
+    unsigned int getFrameCount() const;
+    unsigned int getWindowFrames() const;
+    Format getFormat() const;
+    std::string getOutputPath() const;
+
+    //reads a CSV report written by write(), used by the comparison tool.
+    //false when the file is missing or a row does not parse
+    static bool load(const char* path, std::vector<Stats>& stats);
+
+    //compares current against baseline, prints every system whose p95 grew by more
+    //than thresholdPercent and returns how many systems regressed. A baseline system
+    //missing from current counts as a regression, it may have stopped running.
+    static int compare(const std::vector<Stats>& baseline, const std::vector<Stats>& current,
+        float thresholdPercent);
+
+private:
+    struct channel
+    {
+        std::string name;           // name of the system being timed
+        std::vector<float> samples; // ring buffer of the last windowFrames timings
+        unsigned int count = 0;     // how many samples have been written in total
+    };
+
+    channel& findChannel(const std::string& system);
+
+    std::vector<channel> channels_; // one channel per system, in update order
+    unsigned int cursor_ = 0;       // next channel expected this frame, avoids a search
+    unsigned int frameCount_ = 0;   // how many frames have been recorded
+    unsigned int windowFrames_;     // how many frames each channel keeps
+    Format format_;                 // what type of file is written on shutdown
+    std::string outputPath_;        // where the report is written
+    bool written_ = false;          // whether write() has already succeeded
+};
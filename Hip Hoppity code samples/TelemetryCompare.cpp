@@ -0,0 +1,58 @@
+/*
+ * file: TelemetryCompare.cpp
+ * author: Mark Kouris
+ * brief: small command line tool that checks a telemetry report against a baseline.
+ *        Returns 0 when no system regressed, 1 when one did and 2 on bad input,
+ *        so it can be used as a gate after a replay run of the engine.
+ */
+
+#include "Telemetry.h"
+#include <cmath>     // std::isfinite
+#include <cstdlib>   // strtof
+#include <iostream>
+#include <string>
+
+/* Use Notes:
+
+TelemetryCompare <baseline.csv> <current.csv> [thresholdPercent]
+    thresholdPercent defaults to 10, meaning p95 may grow by 10% before failing.
+
+Both reports should come from the same replay (same frame count and fixed dt)
+or the numbers are not comparable.
+
+*/
+
+static int usage()
+{
+    std::cout << "usage: TelemetryCompare <baseline.csv> <current.csv> [thresholdPercent]" << std::endl;
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+        return usage();
+
+    //the whole argument has to be a number, "10%" or "abc" is bad input, not a crash
+    float threshold = 10.f;
+    if (argc > 3)
+    {
+        char* end = nullptr;
+        threshold = strtof(argv[3], &end);
+        if (end == argv[3] || *end != '\0' || !std::isfinite(threshold) || threshold < 0.f)
+        {
+            std::cout << "bad threshold " << argv[3] << std::endl;
+            return usage();
+        }
+    }
+
+    std::vector<Telemetry::Stats> baseline;
+    std::vector<Telemetry::Stats> current;
+    if (!Telemetry::load(argv[1], baseline) || !Telemetry::load(argv[2], current))
+        return 2;
+
+    int regressions = Telemetry::compare(baseline, current, threshold);
+    std::cout << regressions << " system(s) regressed past " << threshold << "%" << std::endl;
+
+    return regressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,296 @@
+/*
+ * file: TextureAtlas.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the SkylinePacker and TextureAtlas classes,
+ *        this packs and uploads the atlas pages.
+ */
+
+#include "TextureAtlas.h"
+#include "GLState.h"
+#include "stb_image.h"
+#include <algorithm> // std::sort, std::max
+#include <cstring>   // memcpy
+#include <iostream>
+
+/* Use Notes:
+
+Queue every animation of a level first, then build once:
+    atlas.addAnimation("./Data/Assets/Running", "Run_", 8);
+    atlas.addAnimation("./Data/Assets/Jumping", "Jump_", 6);
+    atlas.build();
+    Animation run(atlas, "./Data/Assets/Running", "Run_", 8, 0.1f, 0.1f);
+
+Frames are the same RGBA png files Animation loads, "<folderPath>/<repeatedName><i>.png".
+Images are flipped on load like the Texture loader, so uv 0,0 is the bottom left.
+Every image gets its edge texels copied into the padding so filtering never
+pulls in a neighbouring frame.
+
+*/
+
+//SKYLINE PACKER
+
+SkylinePacker::SkylinePacker(int width, int height) : width_(width), height_(height)
+{
+    skyline_.push_back({ 0, 0, width });
+}
+
+//lowest y a rect could sit at with its left edge on this segment, -1 if it doesn't fit
+int SkylinePacker::fitAt(size_t index, int width, int height) const
+{
+    int x = skyline_[index].x;
+    if (x + width > width_)
+        return -1;
+
+    int y = 0;
+    int widthLeft = width;
+    for (size_t i = index; widthLeft > 0; ++i)
+    {
+        y = std::max(y, skyline_[i].y);
+        if (y + height > height_)
+            return -1;
+        widthLeft -= skyline_[i].width;
+    }
+
+    return y;
+}
+
+//bottom-left rule: lowest top edge wins, narrower segment breaks ties
+bool SkylinePacker::insert(int width, int height, Rect& placed)
+{
+    int bestTop = height_ + 1;
+    int bestWidth = width_ + 1;
+    size_t bestIndex = skyline_.size();
+
+    for (size_t i = 0; i < skyline_.size(); ++i)
+    {
+        int y = fitAt(i, width, height);
+        if (y < 0)
+            continue;
+
+        if (y + height < bestTop || (y + height == bestTop && skyline_[i].width < bestWidth))
+        {
+            bestTop = y + height;
+            bestWidth = skyline_[i].width;
+            bestIndex = i;
+            placed.x = skyline_[i].x;
+            placed.y = y;
+        }
+    }
+
+    if (bestIndex == skyline_.size())
+        return false;
+
+    placed.width = width;
+    placed.height = height;
+    usedArea_ += (long long)width * height;
+
+    //the new rect becomes a segment, then trim whatever it covers
+    skyline_.insert(skyline_.begin() + bestIndex, { placed.x, placed.y + height, width });
+
+    for (size_t i = bestIndex + 1; i < skyline_.size();)
+    {
+        int previousRight = skyline_[i - 1].x + skyline_[i - 1].width;
+        if (skyline_[i].x >= previousRight)
+            break;
+
+        int shrink = previousRight - skyline_[i].x;
+        skyline_[i].x += shrink;
+        skyline_[i].width -= shrink;
+
+        if (skyline_[i].width <= 0)
+            skyline_.erase(skyline_.begin() + i);
+        else
+            break;
+    }
+
+    //merge neighbours at the same height
+    for (size_t i = 0; i + 1 < skyline_.size();)
+    {
+        if (skyline_[i].y == skyline_[i + 1].y)
+        {
+            skyline_[i].width += skyline_[i + 1].width;
+            skyline_.erase(skyline_.begin() + i + 1);
+        }
+        else
+            ++i;
+    }
+
+    return true;
+}
+
+float SkylinePacker::occupancy() const
+{
+    return (float)usedArea_ / ((float)width_ * (float)height_);
+}
+
+//TEXTURE ATLAS
+
+TextureAtlas::TextureAtlas(int pageSize, int padding) : pageSize_(pageSize), padding_(padding)
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    if (!pages_.empty())
+        glDeleteTextures((GLsizei)pages_.size(), pages_.data());
+
+    for (unsigned int page : pages_)
+        GLState::forgetTexture(page);
+}
+
+void TextureAtlas::addImage(const std::string& name, const std::string& path)
+{
+    pending_.push_back({ name, path });
+}
+
+//same naming Animation uses for its frames
+void TextureAtlas::addAnimation(const char* folderPath, const char* repeatedName, int frameCount)
+{
+    for (int i = 0; i < frameCount; ++i)
+    {
+        std::string name = repeatedName + std::to_string(i);
+        addImage(name, std::string(folderPath) + "/" + name + ".png");
+    }
+}
+
+//loads and packs everything queued, largest first, and uploads the pages
+bool TextureAtlas::build()
+{
+    struct image
+    {
+        const pending* source;
+        unsigned char* pixels;
+        int width, height;
+    };
+
+    std::vector<image> images;
+    bool success = true;
+
+    stbi_set_flip_vertically_on_load(true);
+    for (const pending& p : pending_)
+    {
+        image img = { &p, nullptr, 0, 0 };
+        int channels = 0;
+        img.pixels = stbi_load(p.path.c_str(), &img.width, &img.height, &channels, 4);
+
+        if (!img.pixels)
+        {
+            std::cout << "ERROR::ATLAS::FAILED_TO_LOAD " << p.path << std::endl;
+            success = false;
+            continue;
+        }
+        if (img.width + 2 * padding_ > pageSize_ || img.height + 2 * padding_ > pageSize_)
+        {
+            std::cout << "ERROR::ATLAS::IMAGE_LARGER_THAN_PAGE " << p.path << std::endl;
+            stbi_image_free(img.pixels);
+            success = false;
+            continue;
+        }
+        images.push_back(img);
+    }
+
+    //tall images first packs a skyline much tighter
+    std::sort(images.begin(), images.end(), [](const image& a, const image& b)
+        {
+            return a.height != b.height ? a.height > b.height : a.width > b.width;
+        });
+
+    std::vector<SkylinePacker> packers;
+    std::vector<std::vector<unsigned char>> pixels;
+    const size_t pageBytes = (size_t)pageSize_ * pageSize_ * 4;
+
+    for (const image& img : images)
+    {
+        SkylinePacker::Rect rect;
+        size_t page = 0;
+        int paddedWidth = img.width + 2 * padding_;
+        int paddedHeight = img.height + 2 * padding_;
+
+        while (page < packers.size() && !packers[page].insert(paddedWidth, paddedHeight, rect))
+            ++page;
+
+        if (page == packers.size())
+        {
+            packers.push_back(SkylinePacker(pageSize_, pageSize_));
+            pixels.push_back(std::vector<unsigned char>(pageBytes, 0));
+            packers.back().insert(paddedWidth, paddedHeight, rect);
+        }
+
+        //copy rows, extruding the edge texels into the padding
+        unsigned char* dest = pixels[page].data();
+        for (int y = -padding_; y < img.height + padding_; ++y)
+        {
+            int srcY = std::min(std::max(y, 0), img.height - 1);
+            unsigned char* row = dest + ((size_t)(rect.y + padding_ + y) * pageSize_ + rect.x) * 4;
+            const unsigned char* src = img.pixels + (size_t)srcY * img.width * 4;
+
+            memcpy(row + padding_ * 4, src, (size_t)img.width * 4);
+            for (int p = 0; p < padding_; ++p)
+            {
+                memcpy(row + p * 4, src, 4);
+                memcpy(row + (padding_ + img.width + p) * 4, src + (img.width - 1) * 4, 4);
+            }
+        }
+
+        AtlasRegion region;
+        region.page = (unsigned int)(pages_.size() + page);
+        region.uvRect = glm::vec4((float)(rect.x + padding_) / pageSize_, (float)(rect.y + padding_) / pageSize_,
+                                  (float)img.width / pageSize_, (float)img.height / pageSize_);
+        regions_[img.source->name] = region;
+
+        stbi_image_free(img.pixels);
+    }
+
+    //upload every new page
+    for (size_t page = 0; page < pixels.size(); ++page)
+    {
+        unsigned int texture = 0;
+        glGenTextures(1, &texture);
+        GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pageSize_, pageSize_, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels[page].data());
+        pages_.push_back(texture);
+
+#ifdef _DEBUG
+        std::cout << "Atlas page " << pages_.size() - 1 << " is "
+                  << (int)(packers[page].occupancy() * 100.f) << "% full" << std::endl;
+#endif
+    }
+
+    //the page textures only exist now, fill them into the regions
+    for (auto& entry : regions_)
+        entry.second.texture = pages_[entry.second.page];
+
+    pending_.clear();
+    return success;
+}
+
+bool TextureAtlas::find(const std::string& name, AtlasRegion& region) const
+{
+    auto found = regions_.find(name);
+    if (found == regions_.end())
+        return false;
+
+    region = found->second;
+    return true;
+}
+
+//gettors
+
+unsigned int TextureAtlas::getPageCount() const
+{
+    return (unsigned int)pages_.size();
+}
+
+unsigned int TextureAtlas::getPageTexture(unsigned int page) const
+{
+    return pages_[page];
+}
+
+int TextureAtlas::getPageSize() const
+{
+    return pageSize_;
+}
@@ -0,0 +1,97 @@
+/*
+ * file: TextureAtlas.h
+ * author: Mark Kouris
+ * brief: the interface of the SkylinePacker and TextureAtlas classes.
+ *        Packs animation frames into a few shared atlas pages at load time,
+ *        so an Animation advances by switching uv rects instead of textures
+ *        and animated sprites can be batched together.
+ *
+ */
+#pragma once
+#include <glad/glad.h>
+#include "glm/glm/glm.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+//skyline bottom-left rectangle packer for one page
+class SkylinePacker
+{
+public:
+    struct Rect
+    {
+        int x = 0, y = 0, width = 0, height = 0;
+    };
+
+    SkylinePacker(int width, int height);
+
+    //finds room for a width x height rect, returns false if the page is full
+    bool insert(int width, int height, Rect& placed);
+
+    //how much of the page is covered, 0 to 1
+    float occupancy() const;
+
+private:
+    struct segment
+    {
+        int x;     // left edge of this piece of the skyline
+        int y;     // height of the skyline here
+        int width; // how wide this piece is
+    };
+
+    //lowest y a rect could sit at when its left edge is on segment index, -1 if it doesn't fit
+    int fitAt(size_t index, int width, int height) const;
+
+    std::vector<segment> skyline_; // left to right, covers the whole width
+    int width_;                    // width of the page
+    int height_;                   // height of the page
+    long long usedArea_ = 0;       // pixels covered by packed rects
+};
+
+//where one image ended up in the atlas
+struct AtlasRegion
+{
+    unsigned int texture = 0;                  // GL texture of the page holding it
+    unsigned int page = 0;                     // index of that page
+    glm::vec4 uvRect = glm::vec4(0, 0, 1, 1);  // x, y, width, height in uv space
+};
+
+class TextureAtlas
+{
+public:
+    TextureAtlas(int pageSize = 2048, int padding = 1);
+    ~TextureAtlas();
+
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    //queues an image to be packed, name is what the region is looked up by
+    void addImage(const std::string& name, const std::string& path);
+
+    //queues every frame of an animation, named repeatedName + index like Animation does
+    void addAnimation(const char* folderPath, const char* repeatedName, int frameCount);
+
+    //loads and packs everything queued, largest first, and uploads the pages
+    bool build();
+
+    //returns false if the name was never packed
+    bool find(const std::string& name, AtlasRegion& region) const;
+
+    //gettors
+    unsigned int getPageCount() const;
+    unsigned int getPageTexture(unsigned int page) const;
+    int getPageSize() const;
+
+private:
+    struct pending
+    {
+        std::string name; // lookup name
+        std::string path; // file to load
+    };
+
+    std::vector<pending> pending_;                            // queued since the last build
+    std::unordered_map<std::string, AtlasRegion> regions_;     // everything packed so far
+    std::vector<unsigned int> pages_;                         // GL textures, one per page
+    int pageSize_;                                            // width and height of every page
+    int padding_;                                             // empty texels around every image
+};
@@ -0,0 +1,237 @@
+/*
+ * file: TextureBaker.cpp
+ * author: Mark Kouris
+ * brief: command line tool that bakes png sprites or animation frames into
+ *        block compressed files with full mip chains, and reports the size
+ *        saved and the PSNR of the top level for every file.
+ */
+
+#include "BlockCompression.h"
+#include "CompressedTexture.h"
+#include "stb_image.h"
+#include <algorithm> // std::min, std::max
+#include <chrono>
+#include <cmath>
+#include <cstring>   // memcpy
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Use Notes:
+
+TextureBaker <bc1|bc3|bc7|auto> <input.png> [more.png ...]
+    writes <input>.hct next to each input.
+    auto picks BC1 when every alpha is 0 or 255 and BC3 otherwise.
+
+Mips are a plain 2x2 box filter on straight alpha, so very soft sprite
+edges can darken a little in the smallest levels.
+
+*/
+
+struct image
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> texels; // RGBA8, bottom row first
+};
+
+//half size 2x2 box filter, odd edges reuse the last texel
+static image downsample(const image& source)
+{
+    image result;
+    result.width = source.width > 1 ? source.width / 2 : 1;
+    result.height = source.height > 1 ? source.height / 2 : 1;
+    result.texels.resize((size_t)result.width * result.height * 4);
+
+    for (int y = 0; y < result.height; ++y)
+    {
+        for (int x = 0; x < result.width; ++x)
+        {
+            int x0 = std::min(x * 2, source.width - 1), x1 = std::min(x * 2 + 1, source.width - 1);
+            int y0 = std::min(y * 2, source.height - 1), y1 = std::min(y * 2 + 1, source.height - 1);
+
+            for (int c = 0; c < 4; ++c)
+            {
+                int sum = source.texels[((size_t)y0 * source.width + x0) * 4 + c] +
+                          source.texels[((size_t)y0 * source.width + x1) * 4 + c] +
+                          source.texels[((size_t)y1 * source.width + x0) * 4 + c] +
+                          source.texels[((size_t)y1 * source.width + x1) * 4 + c];
+                result.texels[((size_t)y * result.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+
+    return result;
+}
+
+//copies one 4x4 block out, texels past the edge repeat the edge
+static void fetchBlock(const image& source, int blockX, int blockY, unsigned char texels[64])
+{
+    for (int y = 0; y < 4; ++y)
+    {
+        for (int x = 0; x < 4; ++x)
+        {
+            int sx = std::min(blockX * 4 + x, source.width - 1);
+            int sy = std::min(blockY * 4 + y, source.height - 1);
+            memcpy(texels + (y * 4 + x) * 4, &source.texels[((size_t)sy * source.width + sx) * 4], 4);
+        }
+    }
+}
+
+//compresses one level, adds its squared error to error when given
+static std::vector<unsigned char> compressLevel(const image& level, BlockCompression::Format format,
+    double* error)
+{
+    int blocksX = (level.width + 3) / 4;
+    int blocksY = (level.height + 3) / 4;
+    unsigned int blockSize = BlockCompression::blockBytes(format);
+    std::vector<unsigned char> blocks((size_t)blocksX * blocksY * blockSize);
+
+    for (int by = 0; by < blocksY; ++by)
+    {
+        for (int bx = 0; bx < blocksX; ++bx)
+        {
+            unsigned char texels[64];
+            unsigned char* block = &blocks[((size_t)by * blocksX + bx) * blockSize];
+            fetchBlock(level, bx, by, texels);
+            BlockCompression::encode(format, texels, block);
+
+            if (!error)
+                continue;
+
+            //only texels inside the image count toward the PSNR
+            unsigned char decoded[64];
+            BlockCompression::decode(format, block, decoded);
+            for (int y = 0; y < 4 && by * 4 + y < level.height; ++y)
+            {
+                for (int x = 0; x < 4 && bx * 4 + x < level.width; ++x)
+                {
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        double d = (double)texels[(y * 4 + x) * 4 + c] - decoded[(y * 4 + x) * 4 + c];
+                        *error += d * d;
+                    }
+                }
+            }
+        }
+    }
+
+    return blocks;
+}
+
+static bool hasSoftAlpha(const image& source)
+{
+    for (size_t i = 3; i < source.texels.size(); i += 4)
+    {
+        if (source.texels[i] != 0 && source.texels[i] != 255)
+            return true;
+    }
+    return false;
+}
+
+//bakes one png, returns false on failure
+static bool bake(const std::string& path, const std::string& formatName,
+    size_t& rawTotal, size_t& bakedTotal)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    image level;
+    int channels = 0;
+    unsigned char* pixels = stbi_load(path.c_str(), &level.width, &level.height, &channels, 4);
+    if (!pixels)
+    {
+        std::cout << "ERROR::TEXTURE_BAKER::FAILED_TO_LOAD " << path << std::endl;
+        return false;
+    }
+    level.texels.assign(pixels, pixels + (size_t)level.width * level.height * 4);
+    stbi_image_free(pixels);
+
+    BlockCompression::Format format = BlockCompression::BC3;
+    if (formatName == "bc1" || (formatName == "auto" && !hasSoftAlpha(level)))
+        format = BlockCompression::BC1;
+    else if (formatName == "bc7")
+        format = BlockCompression::BC7;
+
+    std::string outPath = CompressedTexture::bakedPath(path);
+    std::ofstream outFile(outPath, std::ofstream::out | std::ofstream::binary);
+    if (!outFile.is_open())
+    {
+        std::cout << "ERROR::TEXTURE_BAKER::COULD_NOT_OPEN " << outPath << std::endl;
+        return false;
+    }
+
+    unsigned int mipCount = 1;
+    for (int size = std::max(level.width, level.height); size > 1; size /= 2)
+        ++mipCount;
+
+    CompressedTextureHeader header = { { 'H', 'H', 'C', 'T' }, COMPRESSED_TEXTURE_VERSION,
+        (uint32_t)format, (uint32_t)level.width, (uint32_t)level.height, mipCount };
+    outFile.write((const char*)&header, sizeof(header));
+
+    double error = 0.0;
+    size_t topTexels = (size_t)level.width * level.height;
+    size_t raw = 0;
+    size_t baked = 0;
+
+    for (unsigned int mip = 0; mip < mipCount; ++mip)
+    {
+        std::vector<unsigned char> blocks = compressLevel(level, format, mip == 0 ? &error : nullptr);
+
+        CompressedMipHeader mipHeader = { (uint32_t)level.width, (uint32_t)level.height, (uint32_t)blocks.size() };
+        outFile.write((const char*)&mipHeader, sizeof(mipHeader));
+        outFile.write((const char*)blocks.data(), blocks.size());
+
+        raw += level.texels.size();
+        baked += blocks.size();
+
+        if (mip + 1 < mipCount)
+            level = downsample(level);
+    }
+
+    double mse = error / (double)(topTexels * 4);
+    double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+    double timeDuration = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    std::cout << outPath << "  BC" << (int)format << "  " << header.width << "x" << header.height
+              << "  mips " << mipCount << "  " << raw / 1024 << " KB -> " << baked / 1024 << " KB"
+              << "  PSNR " << psnr << " dB  " << timeDuration << " ms" << std::endl;
+
+    rawTotal += raw;
+    bakedTotal += baked;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: TextureBaker <bc1|bc3|bc7|auto> <input.png> [more.png ...]" << std::endl;
+        return 2;
+    }
+
+    std::string formatName = argv[1];
+    if (formatName != "bc1" && formatName != "bc3" && formatName != "bc7" && formatName != "auto")
+    {
+        std::cout << "unknown format " << formatName << std::endl;
+        return 2;
+    }
+
+    //same orientation as the runtime loaders, bottom row first
+    stbi_set_flip_vertically_on_load(true);
+
+    size_t rawTotal = 0;
+    size_t bakedTotal = 0;
+    int failures = 0;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        if (!bake(argv[i], formatName, rawTotal, bakedTotal))
+            ++failures;
+    }
+
+    std::cout << "total " << rawTotal / 1024 << " KB -> " << bakedTotal / 1024 << " KB ("
+              << (bakedTotal ? (double)rawTotal / bakedTotal : 0.0) << "x smaller)" << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/*
+ * file: TextureCache.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the TextureCache class,
+ *        this evicts least recently used textures under a byte budget.
+ */
+
+#include "TextureCache.h"
+
+/* Use Notes:
+
+Textures with no handles left can be evicted as soon as the cache is over
+budget, textures that still have handles must also have gone unused for
+evictAfterFrames frames. If everything resident is still in use the cache
+stays over budget rather than thrash, it shows up in getStats().
+
+Only loaded textures are listed, referenced ones in lru_ and the rest in
+unreferenced_. Evicted textures leave their list until they are used again,
+so endFrame only looks at what it evicts plus the first recent entry.
+
+*/
+
+//HANDLE
+
+TextureCache::Handle::Handle(TextureCache* cache, unsigned int index) : cache_(cache), index_(index)
+{
+    cache_->addRef(index_);
+}
+
+TextureCache::Handle::Handle(const Handle& other) : cache_(other.cache_), index_(other.index_)
+{
+    if (cache_)
+        cache_->addRef(index_);
+}
+
+TextureCache::Handle& TextureCache::Handle::operator=(const Handle& other)
+{
+    if (other.cache_)
+        other.cache_->addRef(other.index_);
+    if (cache_)
+        cache_->release(index_);
+
+    cache_ = other.cache_;
+    index_ = other.index_;
+    return *this;
+}
+
+TextureCache::Handle::~Handle()
+{
+    if (cache_)
+        cache_->release(index_);
+}
+
+bool TextureCache::Handle::isValid() const
+{
+    return cache_ != nullptr;
+}
+
+//TEXTURE CACHE
+
+TextureCache::TextureCache(TextureStreamer& streamer, size_t budgetBytes, unsigned int evictAfterFrames) :
+    streamer_(streamer), budget_(budgetBytes), evictAfter_(evictAfterFrames)
+{
+}
+
+TextureCache::Handle TextureCache::acquire(const std::string& path)
+{
+    auto found = paths_.find(path);
+    if (found != paths_.end())
+        return Handle(this, found->second);
+
+    unsigned int index = (unsigned int)entries_.size();
+    entries_.push_back(entry());
+    entry& e = entries_.back();
+    e.request = streamer_.request(path);
+    e.lastUsed = frame_;
+    moveTo(e, index, &lru_);
+
+    paths_[path] = index;
+    return Handle(this, index);
+}
+
+//marks the texture as drawn this frame and returns what to bind
+unsigned int TextureCache::use(const Handle& handle)
+{
+    if (streamer_.isResident(entries_[handle.index_].request))
+        ++stats_.hits;
+    else
+        ++stats_.misses;
+
+    return touch(handle);
+}
+
+//marks the texture as drawn this frame without counting it
+unsigned int TextureCache::touch(const Handle& handle)
+{
+    entry& e = entries_[handle.index_];
+    e.lastUsed = frame_;
+    moveTo(e, handle.index_, &lru_);
+
+    if (!streamer_.isResident(e.request))
+        streamer_.reload(e.request); //does nothing if it is already on its way
+
+    return streamer_.getTexture(e.request);
+}
+
+bool TextureCache::isResident(const Handle& handle) const
+{
+    return streamer_.isResident(entries_[handle.index_].request);
+}
+
+//evicts unreferenced textures first, then referenced ones unused for evictAfter frames,
+//each from the least recently used end until back under budget
+void TextureCache::endFrame()
+{
+    ++frame_;
+
+    std::list<unsigned int>* lists[2] = { &unreferenced_, &lru_ };
+    for (std::list<unsigned int>* list : lists)
+    {
+        auto it = list->end();
+        while (it != list->begin() && streamer_.getResidentBytes() > budget_)
+        {
+            --it;
+            entry& e = entries_[*it];
+
+            //lru_ is ordered by last use, everything in front of a recent entry is recent too
+            if (list == &lru_ && frame_ - e.lastUsed < evictAfter_)
+                break;
+
+            //still loading, it can only be released once it is resident
+            if (!streamer_.isResident(e.request))
+                continue;
+
+            streamer_.release(e.request);
+            ++stats_.evictions;
+            it = list->erase(it);
+            e.list = nullptr;
+        }
+    }
+}
+
+//settors
+
+void TextureCache::setBudget(size_t budgetBytes)
+{
+    budget_ = budgetBytes;
+}
+
+void TextureCache::setEvictAfterFrames(unsigned int frames)
+{
+    evictAfter_ = frames;
+}
+
+//gettors
+
+TextureCache::Stats TextureCache::getStats() const
+{
+    Stats stats = stats_;
+    stats.residentBytes = streamer_.getResidentBytes();
+    stats.budgetBytes = budget_;
+    return stats;
+}
+
+void TextureCache::addRef(unsigned int index)
+{
+    entry& e = entries_[index];
+    if (++e.refs == 1 && e.list == &unreferenced_)
+    {
+        //it goes in at the front of lru_, so it counts as used now to keep lru_ in order
+        e.lastUsed = frame_;
+        moveTo(e, index, &lru_);
+    }
+}
+
+void TextureCache::release(unsigned int index)
+{
+    entry& e = entries_[index];
+    if (--e.refs == 0 && e.list == &lru_)
+        moveTo(e, index, &unreferenced_);
+}
+
+//lists the entry at the front of list, taking it off the one it was on
+void TextureCache::moveTo(entry& e, unsigned int index, std::list<unsigned int>* list)
+{
+    if (e.list)
+        list->splice(list->begin(), *e.list, e.lru);
+    else
+    {
+        list->push_front(index);
+        e.lru = list->begin();
+    }
+    e.list = list;
+}
@@ -0,0 +1,98 @@
+/*
+ * file: TextureCache.h
+ * author: Mark Kouris
+ * brief: the interface of the TextureCache class.
+ *        Keeps streamed textures under a byte budget. Handles are reference
+ *        counted, textures not drawn for a number of frames are evicted least
+ *        recently used first, and evicted textures reload on their next use.
+ *
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include "TextureStreamer.h"
+
+class TextureCache
+{
+public:
+    //reference counted, the cache keeps a texture loadable while any handle exists
+    class Handle
+    {
+    public:
+        Handle() = default;
+        Handle(const Handle& other);
+        Handle& operator=(const Handle& other);
+        ~Handle();
+
+        bool isValid() const;
+
+    private:
+        friend class TextureCache;
+        Handle(TextureCache* cache, unsigned int index);
+
+        TextureCache* cache_ = nullptr; // cache that owns the entry
+        unsigned int index_ = 0;        // entry inside the cache
+    };
+
+    struct Stats
+    {
+        unsigned long long hits = 0;      // uses that found the texture resident
+        unsigned long long misses = 0;    // uses that showed the placeholder
+        unsigned long long evictions = 0; // textures freed to stay under budget
+        size_t residentBytes = 0;         // bytes resident right now
+        size_t budgetBytes = 0;           // the configured budget
+
+        float hitRate() const { return hits + misses ? (float)hits / (float)(hits + misses) : 1.f; }
+    };
+
+    TextureCache(TextureStreamer& streamer, size_t budgetBytes, unsigned int evictAfterFrames = 120);
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    //the same path always maps to the same entry, loading starts right away
+    Handle acquire(const std::string& path);
+
+    //marks the texture as drawn this frame and returns what to bind,
+    //evicted textures are queued again and show the placeholder meanwhile
+    unsigned int use(const Handle& handle);
+    //same as use() but leaves the hit and miss counts alone, for a fallback drawn in place of another texture
+    unsigned int touch(const Handle& handle);
+    bool isResident(const Handle& handle) const;
+
+    //advances the frame counter and evicts until back under budget
+    void endFrame();
+
+    //settors
+    void setBudget(size_t budgetBytes);
+    void setEvictAfterFrames(unsigned int frames);
+
+    //gettors
+    Stats getStats() const;
+
+private:
+    struct entry
+    {
+        TextureStreamer::TextureRequest request; // streamer entry holding the texture
+        unsigned int refs = 0;                   // live handles
+        unsigned int lastUsed = 0;               // frame of the last use()
+        std::list<unsigned int>* list = nullptr; // lru_ or unreferenced_, null once evicted
+        std::list<unsigned int>::iterator lru;   // position in list
+    };
+
+    void addRef(unsigned int index);
+    void release(unsigned int index);
+    void moveTo(entry& e, unsigned int index, std::list<unsigned int>* list); //to the front of list
+
+    TextureStreamer& streamer_;                        // does the loading, its textures live in Resources
+    std::vector<entry> entries_;                       // every texture ever acquired
+    std::unordered_map<std::string, unsigned int> paths_; // path to entry index
+    std::list<unsigned int> lru_;                      // referenced and loaded, most recently used at the front
+    std::list<unsigned int> unreferenced_;             // loaded with no handles left, most recently dropped at the front
+    size_t budget_;                                    // bytes allowed to stay resident
+    unsigned int evictAfter_;                          // frames without use before eviction
+    unsigned int frame_ = 0;                           // frames since the cache was made
+    Stats stats_;                                      // hit, miss and eviction counters
+};
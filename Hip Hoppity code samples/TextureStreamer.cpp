@@ -0,0 +1,362 @@
+/*
+ * file: TextureStreamer.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the TextureStreamer class,
+ *        this decodes on worker threads and uploads through the UploadService.
+ */
+
+#include "TextureStreamer.h"
+#include "CompressedTexture.h"
+#include "GLState.h"
+#include "stb_image.h"
+#include <chrono>
+#include <cstring>   // memcpy
+#include <fstream>
+#include <iostream>
+
+/* Use Notes:
+
+Images are flipped on load like the Texture loader. The flip flag in
+stb_image is global, so it is set once before the workers start and
+nothing else should change it while a TextureStreamer is alive.
+
+Every decode is handed to the GL thread, even failed ones, so pending
+counts always reach zero. A failed request keeps showing the placeholder.
+
+Decoded pngs are staged on the UploadService, so the GL thread only copies
+the pixels and the texture is made on the upload context. A request stays
+loading until the service reports it done. When the service has no context
+the old path runs instead, a pixel buffer upload on the GL thread.
+
+When TextureBaker has written Run_0.hct next to Run_0.png the worker reads
+that instead and the GL thread hands its blocks to the driver (CompressedTexture
+binds through GLState, so it cannot run on the upload thread), so baked
+sprites and frames skip the png decode and take a quarter (BC3, BC7) or
+an eighth (BC1) of the VRAM. A baked file the driver cannot take falls back
+to the png. TextureAtlas packs its pages from the pngs at load time, so
+atlas pages are never baked.
+
+Every loaded texture goes into the Resources texture pool. release() hands
+it back there, so an evicted texture stays valid for whatever was already
+recorded this frame and is deleted by Resources::collect(). The placeholder
+and the pixel buffers belong to the streamer.
+
+*/
+
+TextureStreamer::TextureStreamer(UploadService& uploads, unsigned int workers) : uploads_(uploads)
+{
+    if (workers == 0)
+    {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        workers = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    //magenta so missing frames are easy to spot
+    const unsigned char magenta[4] = { 255, 0, 255, 255 };
+    glGenTextures(1, &placeholder_);
+    GLState::bindTexture(0, GL_TEXTURE_2D, placeholder_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, magenta);
+
+    glGenBuffers(2, PBO);
+
+    stbi_set_flip_vertically_on_load(true);
+    for (unsigned int i = 0; i < workers; ++i)
+        workers_.push_back(std::thread(&TextureStreamer::workerLoop, this));
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+        jobs_.clear();
+    }
+    wake_.notify_all();
+
+    for (std::thread& worker : workers_)
+        worker.join();
+
+    for (decoded& image : done_)
+        stbi_image_free(image.pixels);
+
+    //uploads still in flight become textures that are deleted below
+    for (TextureRequest request : uploading_)
+        uploads_.wait(entries_[request].ticket);
+    finishUploads();
+
+    for (TextureRequest request = 0; request < (TextureRequest)entries_.size(); ++request)
+        release(request);
+
+    glDeleteBuffers(2, PBO);
+    glDeleteTextures(1, &placeholder_);
+    GLState::forgetBuffer(PBO[0]);
+    GLState::forgetBuffer(PBO[1]);
+    GLState::forgetTexture(placeholder_);
+}
+
+//queues a png for decoding, GL thread only
+TextureStreamer::TextureRequest TextureStreamer::request(const std::string& path)
+{
+    TextureRequest request = (TextureRequest)entries_.size();
+    entries_.push_back(entry());
+    entries_.back().path = path;
+
+    reload(request);
+    return request;
+}
+
+//frees the texture at the next collect, the entry keeps its path so it can be loaded again
+void TextureStreamer::release(TextureRequest request)
+{
+    entry& e = entries_[request];
+    if (!e.resident)
+        return;
+
+    Resources::current().release(e.texture);
+    e.texture = TextureHandle();
+    e.resident = false;
+    residentBytes_ -= e.bytes;
+}
+
+//queues the entry for decoding
+void TextureStreamer::reload(TextureRequest request)
+{
+    entry& e = entries_[request];
+    if (e.resident || e.loading)
+        return;
+
+    e.loading = true;
+    ++pending_;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back({ request, e.path });
+    }
+    wake_.notify_one();
+}
+
+//uploads decoded images until the budget is spent, always uploads at least one
+void TextureStreamer::pump(float budgetMs)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    finishUploads();
+
+    for (;;)
+    {
+        decoded image;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (done_.empty())
+                break;
+            image = std::move(done_.front());
+            done_.pop_front();
+        }
+
+        upload(image);
+
+        float spent = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (spent >= budgetMs)
+            break;
+    }
+
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+//blocks until everything requested is resident
+void TextureStreamer::finish()
+{
+    while (pending_ > 0)
+    {
+        uploads_.poll();
+        pump(1000.f);
+        if (pending_ > 0)
+            std::this_thread::yield();
+    }
+}
+
+unsigned int TextureStreamer::getTexture(TextureRequest request) const
+{
+    const entry& e = entries_[request];
+    return e.resident ? Resources::current().get(e.texture)->texture : placeholder_;
+}
+
+bool TextureStreamer::isResident(TextureRequest request) const
+{
+    return entries_[request].resident;
+}
+
+bool TextureStreamer::isLoading(TextureRequest request) const
+{
+    return entries_[request].loading;
+}
+
+size_t TextureStreamer::getBytes(TextureRequest request) const
+{
+    return entries_[request].bytes;
+}
+
+size_t TextureStreamer::getResidentBytes() const
+{
+    return residentBytes_;
+}
+
+unsigned int TextureStreamer::getPlaceholder() const
+{
+    return placeholder_;
+}
+
+unsigned int TextureStreamer::getPendingCount() const
+{
+    return pending_;
+}
+
+//decodes jobs until told to quit, no GL calls in here
+void TextureStreamer::workerLoop()
+{
+    for (;;)
+    {
+        job next;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return quit_ || !jobs_.empty(); });
+            if (quit_)
+                return;
+
+            next = jobs_.front();
+            jobs_.pop_front();
+        }
+
+        decoded image;
+        image.request = next.request;
+
+        //a baked sibling is used as it is, the png is only decoded without one
+        std::string baked = CompressedTexture::bakedPath(next.path);
+        if (!std::ifstream(baked).is_open() || !CompressedTexture::read(baked.c_str(), image.baked))
+        {
+            image.baked.clear();
+            int channels = 0;
+            image.pixels = stbi_load(next.path.c_str(), &image.width, &image.height, &channels, 4);
+            if (!image.pixels)
+                std::cout << "ERROR::TEXTURE_STREAMER::FAILED_TO_LOAD " << next.path << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_.push_back(std::move(image));
+    }
+}
+
+//stages the pixels on the upload service, or copies into a pixel buffer
+//and lets the driver do the transfer from there when it has no context
+void TextureStreamer::upload(const decoded& image)
+{
+    entry& e = entries_[image.request];
+
+    //baked blocks need no pixel buffer, there is no conversion left for the driver to do
+    if (!image.baked.empty())
+    {
+        finishLoading(e);
+        const CompressedTextureHeader* header = (const CompressedTextureHeader*)image.baked.data();
+        e.width = (int)header->width;
+        e.height = (int)header->height;
+
+        unsigned int bytes = 0;
+        unsigned int texture = CompressedTexture::create(image.baked, e.path.c_str(), &bytes);
+        if (texture)
+            makeResident(e, texture, bytes);
+        return;
+    }
+
+    if (!image.pixels)
+    {
+        finishLoading(e);
+        return;
+    }
+
+    const GLsizeiptr bytes = (GLsizeiptr)image.width * image.height * 4;
+    e.width = image.width;
+    e.height = image.height;
+
+    //the texture is made on the upload context, finishUploads makes it resident
+    if (uploads_.isRunning())
+    {
+        e.bytes = (size_t)bytes;
+        e.ticket = uploads_.createTexture(image.width, image.height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE,
+            std::vector<unsigned char>(image.pixels, image.pixels + bytes), false);
+        uploading_.push_back(image.request);
+        stbi_image_free(image.pixels);
+        return;
+    }
+
+    finishLoading(e);
+    unsigned int pbo = PBO[nextPBO_];
+    nextPBO_ = (nextPBO_ + 1) % 2;
+
+    //orphan then fill, so the previous upload from this buffer never blocks us
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+    void* dest = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+    if (dest)
+    {
+        memcpy(dest, image.pixels, (size_t)bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        unsigned int texture = 0;
+        glGenTextures(1, &texture);
+        GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        makeResident(e, texture, (size_t)bytes);
+    }
+
+    stbi_image_free(image.pixels);
+}
+
+//every upload the service is done with becomes resident, failed ones keep the placeholder
+void TextureStreamer::finishUploads()
+{
+    for (size_t i = 0; i < uploading_.size();)
+    {
+        entry& e = entries_[uploading_[i]];
+        if (!uploads_.isDone(e.ticket) && !uploads_.isFailed(e.ticket))
+        {
+            ++i;
+            continue;
+        }
+
+        unsigned int texture = uploads_.getObject(e.ticket);
+        if (texture)
+            makeResident(e, texture, e.bytes);
+        uploads_.forget(e.ticket);
+        e.ticket = 0;
+        finishLoading(e);
+
+        uploading_[i] = uploading_.back();
+        uploading_.pop_back();
+    }
+}
+
+void TextureStreamer::finishLoading(entry& e)
+{
+    e.loading = false;
+    --pending_;
+}
+
+//a full pool has already deleted texture, the request then keeps the placeholder
+void TextureStreamer::makeResident(entry& e, unsigned int texture, size_t bytes)
+{
+    e.texture = Resources::current().addTexture(texture, e.width, e.height);
+    if (!e.texture.isValid())
+        return;
+
+    e.resident = true;
+    e.bytes = bytes;
+    residentBytes_ += e.bytes;
+}
@@ -0,0 +1,108 @@
+/*
+ * file: TextureStreamer.h
+ * author: Mark Kouris
+ * brief: the interface of the TextureStreamer class.
+ *        Decodes png files (or reads their baked .hct siblings) on a pool of
+ *        worker threads and hands the pixels to the UploadService, which makes
+ *        the textures on its own context. The GL thread spends at most a given
+ *        number of milliseconds per frame staging them. Requests return right
+ *        away and draw a placeholder until their texture is resident.
+ *
+ */
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "UploadService.h"
+#include "Resources.h"
+
+class TextureStreamer
+{
+public:
+    typedef unsigned int TextureRequest;
+
+    //0 workers means one less than the hardware threads. uploads has to outlive the streamer
+    TextureStreamer(UploadService& uploads, unsigned int workers = 0);
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    //queues a png for decoding, GL thread only. A baked path.hct next to it is loaded instead
+    TextureRequest request(const std::string& path);
+
+    //releases the texture of a resident request to Resources, deleted at the next collect.
+    //The request shows the placeholder until reload()
+    void release(TextureRequest request);
+
+    //queues a released request for decoding again, does nothing if resident or loading
+    void reload(TextureRequest request);
+
+    //stages decoded images until budgetMs is spent, GL thread only, call once per frame
+    //after UploadService::poll. Uploads that finished since the last pump become resident
+    void pump(float budgetMs);
+
+    //blocks until everything requested is resident, for loading screens
+    void finish();
+
+    //the real texture once resident, the placeholder before that
+    unsigned int getTexture(TextureRequest request) const;
+    bool isResident(TextureRequest request) const;
+    bool isLoading(TextureRequest request) const;
+    size_t getBytes(TextureRequest request) const; //size of the uploaded image, 0 before the first upload
+    size_t getResidentBytes() const; //total size of every resident texture
+    unsigned int getPlaceholder() const;
+    unsigned int getPendingCount() const; //requested but not resident yet
+
+private:
+    struct entry
+    {
+        std::string path;         // file being loaded
+        TextureHandle texture;    // in Resources, invalid until uploaded
+        int width = 0;            // texels, once decoded
+        int height = 0;
+        bool resident = false;    // whether texture holds the image
+        bool loading = false;     // queued, decoding or uploading
+        size_t bytes = 0;         // VRAM the texture takes once known
+        UploadService::UploadTicket ticket = 0; // upload in flight, 0 when there is none
+    };
+
+    struct job
+    {
+        TextureRequest request;   // which entry to fill
+        std::string path;         // copied so workers never touch entries_
+    };
+
+    struct decoded
+    {
+        TextureRequest request = 0;       // which entry this belongs to
+        unsigned char* pixels = nullptr;  // RGBA8 from stb_image, null if loading failed or baked is used
+        int width = 0, height = 0;        // size of the image
+        std::vector<unsigned char> baked; // the whole .hct file when the png has a baked sibling
+    };
+
+    void workerLoop();
+    void upload(const decoded& image);
+    void finishUploads();                    // picks up textures the upload service is done with
+    void finishLoading(entry& e);            // the request stops counting as pending
+    void makeResident(entry& e, unsigned int texture, size_t bytes); // hands texture to Resources
+
+    UploadService& uploads_;                // makes the png textures on its own context
+    std::vector<entry> entries_;            // every request, indexed by TextureRequest
+    std::vector<TextureRequest> uploading_;  // waiting on uploads_
+    std::deque<job> jobs_;                   // waiting for a worker
+    std::deque<decoded> done_;               // waiting for the GL thread
+    std::vector<std::thread> workers_;       // decode threads
+    mutable std::mutex mutex_;               // guards jobs_, done_ and quit_
+    std::condition_variable wake_;           // signals new jobs or shutdown
+    bool quit_ = false;                      // tells the workers to exit
+    unsigned int pending_ = 0;               // requests not resident yet
+    size_t residentBytes_ = 0;               // sum of bytes over resident entries
+    unsigned int placeholder_ = 0;           // 1x1 texture shown while loading
+    unsigned int PBO[2] = {};                // pixel buffers used in turn when uploads_ has no context
+    unsigned int nextPBO_ = 0;               // which pixel buffer is next
+};
@@ -0,0 +1,391 @@
+/*
+ * file: UploadService.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the UploadService class,
+ *        this issues staged uploads on a shared context and fences them.
+ */
+
+#include "UploadService.h"
+#include "GLState.h"
+#include <iostream>
+
+/* Use Notes:
+
+The engine makes the shared context from a hidden 1x1 GLFW window created
+with the main window as its share, see Engine::Initialize. Anything else
+that can make a context current on another thread works the same way (EGL
+pbuffers for headless runs with LIBGL_ALWAYS_SOFTWARE=1 on Mesa).
+
+    UploadService::UploadTicket ticket = uploads.createTexture(w, h, GL_RGBA8, GL_RGBA,
+        GL_UNSIGNED_BYTE, std::move(pixels));
+    ...
+    if (uploads.isDone(ticket)) //poll() ran this frame
+    {
+        texture = uploads.getObject(ticket);
+        uploads.forget(ticket);
+    }
+
+The upload thread never goes through GLState, its context has bindings of
+its own. Objects changed there must be bound again on the GL thread after
+they are done before their new contents are guaranteed to show, binding a
+new object for the first time already does that. GLState would filter that
+bind out for an object it thinks is still bound, so poll() makes it forget
+every updated buffer and texture and the next GLState bind is issued.
+
+Each wake of the upload thread takes everything staged so far as one batch
+with one fence, so a burst of small uploads costs one fence and one flush.
+
+*/
+
+#define WAIT_SLICE 100000000 //0.1 seconds in nanoseconds, wait() loops in slices
+
+UploadService::UploadService(const std::function<bool()>& makeCurrent, const std::function<void()>& doneCurrent) :
+    makeCurrent_(makeCurrent), doneCurrent_(doneCurrent)
+{
+    thread_ = std::thread(&UploadService::uploadLoop, this);
+
+    //isRunning is meaningful as soon as the constructor returns
+    std::unique_lock<std::mutex> lock(mutex_);
+    submitted_.wait(lock, [this] { return started_; });
+}
+
+UploadService::~UploadService()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+
+    //the fences belong to the share group, the GL thread can delete them
+    for (batch& b : inFlight_)
+        glDeleteSync(b.fence);
+}
+
+bool UploadService::isRunning() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
+}
+
+UploadService::UploadTicket UploadService::createBuffer(std::vector<unsigned char> data, GLenum usage)
+{
+    job work;
+    work.operation = CREATE_BUFFER;
+    work.usage = usage;
+    work.data = std::move(data);
+    return stage(std::move(work));
+}
+
+UploadService::UploadTicket UploadService::updateBuffer(unsigned int buffer, size_t offset,
+    std::vector<unsigned char> data)
+{
+    job work;
+    work.operation = UPDATE_BUFFER;
+    work.object = buffer;
+    work.offset = offset;
+    work.data = std::move(data);
+    return stage(std::move(work));
+}
+
+UploadService::UploadTicket UploadService::createTexture(int width, int height, GLenum internalFormat,
+    GLenum format, GLenum type, std::vector<unsigned char> pixels, bool mipmaps)
+{
+    job work;
+    work.operation = CREATE_TEXTURE;
+    work.width = width;
+    work.height = height;
+    work.internalFormat = internalFormat;
+    work.format = format;
+    work.type = type;
+    work.mipmaps = mipmaps;
+    work.data = std::move(pixels);
+    return stage(std::move(work));
+}
+
+UploadService::UploadTicket UploadService::updateTexture(unsigned int texture, int level, int x, int y,
+    int width, int height, GLenum format, GLenum type, std::vector<unsigned char> pixels)
+{
+    job work;
+    work.operation = UPDATE_TEXTURE;
+    work.object = texture;
+    work.level = level;
+    work.x = x;
+    work.y = y;
+    work.width = width;
+    work.height = height;
+    work.format = format;
+    work.type = type;
+    work.data = std::move(pixels);
+    return stage(std::move(work));
+}
+
+UploadService::UploadTicket UploadService::stage(job&& work)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    work.ticket = nextTicket_++;
+    if (nextTicket_ == 0)
+        nextTicket_ = 1;
+
+    record& r = records_[work.ticket];
+    if (!running_)
+    {
+        r.status = FAILED;
+        return work.ticket;
+    }
+
+    jobs_.push_back(std::move(work));
+    ++pending_;
+    wake_.notify_one();
+    return jobs_.back().ticket;
+}
+
+//GL thread, once per frame
+void UploadService::poll()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (size_t i = 0; i < inFlight_.size();)
+    {
+        GLenum result = glClientWaitSync(inFlight_[i].fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            ++i;
+            continue;
+        }
+
+        for (UploadTicket ticket : inFlight_[i].tickets)
+        {
+            std::unordered_map<UploadTicket, record>::iterator found = records_.find(ticket);
+            if (found != records_.end())
+                found->second.status = DONE;
+        }
+
+        //the next bind on this context has to reach GL, see the Use Notes
+        for (unsigned int buffer : inFlight_[i].updatedBuffers)
+            GLState::forgetBuffer(buffer);
+        for (unsigned int texture : inFlight_[i].updatedTextures)
+            GLState::forgetTexture(texture);
+
+        pending_ -= (unsigned int)inFlight_[i].tickets.size();
+        glDeleteSync(inFlight_[i].fence);
+        inFlight_.erase(inFlight_.begin() + i);
+    }
+}
+
+//GL thread, blocks until this upload is done
+void UploadService::wait(UploadTicket ticket)
+{
+    GLsync fence = 0;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        submitted_.wait(lock, [this, ticket] {
+            std::unordered_map<UploadTicket, record>::iterator found = records_.find(ticket);
+            return found == records_.end() || found->second.status != STAGED || !running_;
+        });
+
+        for (const batch& b : inFlight_)
+        {
+            for (UploadTicket t : b.tickets)
+            {
+                if (t == ticket)
+                    fence = b.fence;
+            }
+        }
+    }
+
+    //only this thread deletes fences, so it stays valid outside the lock
+    if (fence)
+    {
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_SLICE) == GL_TIMEOUT_EXPIRED)
+        {
+        }
+    }
+
+    poll();
+}
+
+bool UploadService::isDone(UploadTicket ticket) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_map<UploadTicket, record>::const_iterator found = records_.find(ticket);
+    return found != records_.end() && found->second.status == DONE;
+}
+
+bool UploadService::isFailed(UploadTicket ticket) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_map<UploadTicket, record>::const_iterator found = records_.find(ticket);
+    return found != records_.end() && found->second.status == FAILED;
+}
+
+unsigned int UploadService::getObject(UploadTicket ticket) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_map<UploadTicket, record>::const_iterator found = records_.find(ticket);
+    return found != records_.end() && found->second.status == DONE ? found->second.object : 0;
+}
+
+void UploadService::forget(UploadTicket ticket)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    records_.erase(ticket);
+}
+
+unsigned int UploadService::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+//upload thread
+void UploadService::uploadLoop()
+{
+    bool current = makeCurrent_();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        started_ = true;
+        running_ = current;
+    }
+    submitted_.notify_all();
+
+    if (!current)
+    {
+        std::cout << "ERROR::UPLOAD_SERVICE::NO_SHARED_CONTEXT" << std::endl;
+        return;
+    }
+
+    //staged pixels are tightly packed
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    std::deque<job> work;
+    std::vector<std::pair<UploadTicket, unsigned int>> issued;
+    batch b;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return quit_ || !jobs_.empty(); });
+            if (quit_)
+                break;
+            work.swap(jobs_);
+        }
+
+        //GL copies client memory before each call returns, so staging is freed as we go
+        issued.clear();
+        b = batch();
+        for (job& j : work)
+        {
+            unsigned int object = issue(j);
+            issued.push_back(std::make_pair(j.ticket, object));
+            std::vector<unsigned char>().swap(j.data);
+
+            if (object && j.operation == UPDATE_BUFFER)
+                b.updatedBuffers.push_back(object);
+            else if (object && j.operation == UPDATE_TEXTURE)
+                b.updatedTextures.push_back(object);
+        }
+        work.clear();
+
+        b.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush(); //the fence has to reach the GPU before another context can wait on it
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const std::pair<UploadTicket, unsigned int>& upload : issued)
+            {
+                std::unordered_map<UploadTicket, record>::iterator found = records_.find(upload.first);
+                if (upload.second == 0)
+                {
+                    --pending_;
+                    if (found != records_.end())
+                        found->second.status = FAILED;
+                    continue;
+                }
+
+                b.tickets.push_back(upload.first);
+                if (found != records_.end())
+                {
+                    found->second.status = IN_FLIGHT;
+                    found->second.object = upload.second;
+                }
+            }
+            inFlight_.push_back(std::move(b));
+        }
+        submitted_.notify_all();
+    }
+
+    //staged uploads that never ran fail
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const job& j : jobs_)
+        {
+            std::unordered_map<UploadTicket, record>::iterator found = records_.find(j.ticket);
+            if (found != records_.end())
+                found->second.status = FAILED;
+        }
+        pending_ -= (unsigned int)jobs_.size();
+        jobs_.clear();
+        running_ = false;
+    }
+    submitted_.notify_all();
+
+    glFinish();
+    doneCurrent_();
+}
+
+//upload thread, returns the object name or 0 if GL refused the upload
+unsigned int UploadService::issue(job& work)
+{
+    while (glGetError() != GL_NO_ERROR)
+    {
+    }
+
+    unsigned int object = work.object;
+    switch (work.operation)
+    {
+    case CREATE_BUFFER:
+        glGenBuffers(1, &object);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, object);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)work.data.size(), work.data.data(), work.usage);
+        break;
+
+    case UPDATE_BUFFER:
+        glBindBuffer(GL_COPY_WRITE_BUFFER, object);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)work.offset, (GLsizeiptr)work.data.size(), work.data.data());
+        break;
+
+    case CREATE_TEXTURE:
+        glGenTextures(1, &object);
+        glBindTexture(GL_TEXTURE_2D, object);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, work.mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, (GLint)work.internalFormat, work.width, work.height, 0,
+            work.format, work.type, work.data.data());
+        if (work.mipmaps)
+            glGenerateMipmap(GL_TEXTURE_2D);
+        break;
+
+    case UPDATE_TEXTURE:
+        glBindTexture(GL_TEXTURE_2D, object);
+        glTexSubImage2D(GL_TEXTURE_2D, work.level, work.x, work.y, work.width, work.height,
+            work.format, work.type, work.data.data());
+        break;
+    }
+
+    GLenum error = glGetError();
+    if (error == GL_NO_ERROR)
+        return object;
+
+    std::cout << "ERROR::UPLOAD_SERVICE::GL_ERROR " << error << " ticket " << work.ticket << std::endl;
+    if (work.operation == CREATE_BUFFER)
+        glDeleteBuffers(1, &object);
+    else if (work.operation == CREATE_TEXTURE)
+        glDeleteTextures(1, &object);
+    return 0;
+}
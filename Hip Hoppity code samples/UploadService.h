@@ -0,0 +1,117 @@
+/*
+ * file: UploadService.h
+ * author: Mark Kouris
+ * brief: the interface of the UploadService class.
+ *        Buffer and texture uploads run on their own thread with a second GL
+ *        context shared with the main one. Any thread can stage an upload,
+ *        the upload thread issues it and fences it, and the GL thread sees it
+ *        finish in poll() without ever waiting on the driver copy.
+ *
+ */
+#pragma once
+#include <glad/glad.h>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+class UploadService
+{
+public:
+    typedef unsigned int UploadTicket; // 0 is never a valid ticket
+
+    //run on the upload thread, makeCurrent binds the shared context to it
+    //and returns false if it could not, doneCurrent unbinds it before the thread exits
+    UploadService(const std::function<bool()>& makeCurrent, const std::function<void()>& doneCurrent);
+    ~UploadService();
+
+    UploadService(const UploadService&) = delete;
+    UploadService& operator=(const UploadService&) = delete;
+
+    //false when the upload thread could not get its context, every upload then fails right away
+    bool isRunning() const;
+
+    //any thread. The data is moved into the service, the caller can drop it at once
+
+    //makes a new buffer holding data, getObject gives its name once done
+    UploadTicket createBuffer(std::vector<unsigned char> data, GLenum usage = GL_STATIC_DRAW);
+    //copies data into an existing buffer at offset
+    UploadTicket updateBuffer(unsigned int buffer, size_t offset, std::vector<unsigned char> data);
+    //makes a new 2D texture, mipmaps are generated on the upload thread
+    UploadTicket createTexture(int width, int height, GLenum internalFormat, GLenum format, GLenum type,
+        std::vector<unsigned char> pixels, bool mipmaps = true);
+    //copies pixels into part of one level of an existing 2D texture
+    UploadTicket updateTexture(unsigned int texture, int level, int x, int y, int width, int height,
+        GLenum format, GLenum type, std::vector<unsigned char> pixels);
+
+    //GL thread, once per frame. Moves every upload whose fence has signaled to done
+    void poll();
+
+    //GL thread, blocks until this upload is done, for loading screens
+    void wait(UploadTicket ticket);
+
+    //any thread
+    bool isDone(UploadTicket ticket) const;
+    bool isFailed(UploadTicket ticket) const;
+    unsigned int getObject(UploadTicket ticket) const; //new or updated GL name, 0 until done
+    void forget(UploadTicket ticket); //drops the record, a created object stays alive
+    unsigned int getPendingCount() const; //staged or in flight
+
+private:
+    enum state { STAGED, IN_FLIGHT, DONE, FAILED };
+    enum kind { CREATE_BUFFER, UPDATE_BUFFER, CREATE_TEXTURE, UPDATE_TEXTURE };
+
+    struct job
+    {
+        UploadTicket ticket;
+        kind operation;
+        unsigned int object = 0;          // updated object, 0 for creates
+        size_t offset = 0;                // buffer offset
+        GLenum usage = GL_STATIC_DRAW;    // buffer usage
+        int level = 0;                    // texture level
+        int x = 0, y = 0;                 // texture region
+        int width = 0, height = 0;
+        GLenum internalFormat = GL_RGBA8;
+        GLenum format = GL_RGBA;
+        GLenum type = GL_UNSIGNED_BYTE;
+        bool mipmaps = false;
+        std::vector<unsigned char> data;  // staged bytes, freed once GL has copied them
+    };
+
+    struct record
+    {
+        state status = STAGED;
+        unsigned int object = 0;          // GL name once the upload thread has issued it
+    };
+
+    struct batch
+    {
+        GLsync fence;                     // signals when every upload in the batch is done
+        std::vector<UploadTicket> tickets;
+        std::vector<unsigned int> updatedBuffers;  // GLState forgets these once the fence signals
+        std::vector<unsigned int> updatedTextures;
+    };
+
+    UploadTicket stage(job&& work);
+    void uploadLoop();
+    unsigned int issue(job& work);        // upload thread, returns the object name
+
+    std::function<bool()> makeCurrent_;
+    std::function<void()> doneCurrent_;
+
+    std::thread thread_;
+    mutable std::mutex mutex_;                             // guards everything below
+    std::condition_variable wake_;                         // new jobs or shutdown
+    std::condition_variable submitted_;                    // a batch was fenced, or the thread gave up
+    std::deque<job> jobs_;                                 // staged, waiting for the upload thread
+    std::vector<batch> inFlight_;                          // fenced, waiting for poll()
+    std::unordered_map<UploadTicket, record> records_;     // every ticket not forgotten
+    UploadTicket nextTicket_ = 1;
+    unsigned int pending_ = 0;                             // staged or in flight
+    bool running_ = false;                                 // the thread has its context
+    bool started_ = false;                                 // the thread has tried to get it
+    bool quit_ = false;                                    // tells the thread to exit
+};
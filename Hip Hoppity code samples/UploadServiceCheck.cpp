@@ -0,0 +1,235 @@
+/*
+ * file: UploadServiceCheck.cpp
+ * author: Mark Kouris
+ * brief: command line check for UploadService. Stages buffers and textures
+ *        from several threads, reads every one back on the main context and
+ *        reports how long the main thread spent per frame while they went up.
+ *        Then updates part of each object and checks the change shows through
+ *        GLState binds on the main context.
+ */
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "UploadService.h"
+#include "GLState.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/* Use Notes:
+
+UploadServiceCheck [uploads] [threads]
+    uploads defaults to 256 (half buffers, half 256x256 textures), threads to 4.
+
+Uses two shared EGL contexts without any surface, so it needs no window
+system at all:
+    LIBGL_ALWAYS_SOFTWARE=1 ./UploadServiceCheck
+runs on Mesa's software rasterizer (llvmpipe) with EGL_MESA_platform_surfaceless.
+Returns 0 when every upload and update reads back with the bytes that were
+staged, 1 otherwise.
+
+*/
+
+#define BUFFER_BYTES 65536
+#define TEXTURE_SIZE 256
+#define UPDATE_BYTES 256 //bytes of each buffer, and texels of each texture's first row, that are updated
+
+//helper, the fill byte of upload i, never 0 so an empty object is caught
+static unsigned char fillOf(int i)
+{
+    return (unsigned char)(i % 255 + 1);
+}
+
+//helper, the byte an update writes over upload i, never its fill byte
+static unsigned char updateOf(int i)
+{
+    return (unsigned char)(255 - i % 127);
+}
+
+//helper, binds upload i through GLState, the way the engine would
+static void bindObject(int i, unsigned int object)
+{
+    if (i % 2 == 0)
+        GLState::bindBuffer(GL_ARRAY_BUFFER, object);
+    else
+        GLState::bindTexture(0, GL_TEXTURE_2D, object);
+}
+
+//helper, binds upload i and reads the whole object back
+static void readBack(int i, unsigned int object, std::vector<unsigned char>& bytes)
+{
+    bindObject(i, object);
+    if (i % 2 == 0)
+    {
+        bytes.assign(BUFFER_BYTES, 0);
+        glGetBufferSubData(GL_ARRAY_BUFFER, 0, BUFFER_BYTES, bytes.data());
+    }
+    else
+    {
+        bytes.assign(TEXTURE_SIZE * TEXTURE_SIZE * 4, 0);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, bytes.data());
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int uploads = argc > 1 ? std::stoi(argv[1]) : 256;
+    int threads = argc > 2 ? std::stoi(argv[2]) : 4;
+
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = getPlatformDisplay ?
+        getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) : EGL_NO_DISPLAY;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr) || !eglBindAPI(EGL_OPENGL_API))
+    {
+        printf("could not start EGL\n");
+        return 1;
+    }
+
+    const EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    const EGLint contextAttributes[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+    EGLConfig config;
+    EGLint configCount = 0;
+    eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+    EGLContext mainContext = configCount ? eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes) : EGL_NO_CONTEXT;
+    EGLContext uploadContext = mainContext ? eglCreateContext(display, config, mainContext, contextAttributes) : EGL_NO_CONTEXT;
+    if (!uploadContext)
+    {
+        printf("could not create shared GL contexts\n");
+        eglTerminate(display);
+        return 1;
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, mainContext);
+    gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+    printf("%s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+
+    int failures = 0;
+    {
+        UploadService service([display, uploadContext] {
+                return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, uploadContext) == EGL_TRUE; },
+            [display] { eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT); });
+
+        //every thread stages its share, even uploads are buffers and odd ones textures
+        std::vector<UploadService::UploadTicket> tickets(uploads);
+        std::atomic<int> stagedCount(0);
+        std::vector<std::thread> stagers;
+        for (int t = 0; t < threads; ++t)
+        {
+            stagers.push_back(std::thread([&service, &tickets, &stagedCount, uploads, threads, t] {
+                for (int i = t; i < uploads; i += threads)
+                {
+                    if (i % 2 == 0)
+                        tickets[i] = service.createBuffer(std::vector<unsigned char>(BUFFER_BYTES, fillOf(i)));
+                    else
+                        tickets[i] = service.createTexture(TEXTURE_SIZE, TEXTURE_SIZE, GL_RGBA8, GL_RGBA,
+                            GL_UNSIGNED_BYTE, std::vector<unsigned char>(TEXTURE_SIZE * TEXTURE_SIZE * 4, fillOf(i)));
+                    ++stagedCount;
+                }
+            }));
+        }
+
+        //the main thread keeps "rendering", only poll() runs on it
+        int frames = 0;
+        double worstMs = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (;;)
+        {
+            std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+            service.poll();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+            worstMs = ms > worstMs ? ms : worstMs;
+            ++frames;
+
+            if (stagedCount == uploads && service.getPendingCount() == 0)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        for (std::thread& stager : stagers)
+            stager.join();
+
+        //read everything back through the main context
+        std::vector<unsigned int> objects(uploads);
+        std::vector<unsigned char> bytes;
+        for (int i = 0; i < uploads; ++i)
+        {
+            objects[i] = service.getObject(tickets[i]);
+            service.forget(tickets[i]);
+            bool good = objects[i] != 0;
+            if (good)
+                readBack(i, objects[i], bytes);
+
+            for (size_t b = 0; good && b < bytes.size(); ++b)
+                good = bytes[b] == fillOf(i);
+            if (!good)
+            {
+                printf("upload %d did not read back\n", i);
+                ++failures;
+            }
+        }
+
+        printf("%d uploads from %d threads in %.1f ms, %d polls, slowest poll %.3f ms, %d failed\n",
+            uploads, threads, totalMs, frames, worstMs, failures);
+
+        //each object is bound before its update, so GLState would filter the bind before
+        //the read back unless poll() made it forget the updated object
+        int updateFailures = 0;
+        for (int i = 0; i < uploads; ++i)
+        {
+            if (!objects[i])
+                continue;
+
+            bindObject(i, objects[i]);
+            UploadService::UploadTicket ticket;
+            if (i % 2 == 0)
+                ticket = service.updateBuffer(objects[i], 0, std::vector<unsigned char>(UPDATE_BYTES, updateOf(i)));
+            else
+                ticket = service.updateTexture(objects[i], 0, 0, 0, UPDATE_BYTES / 4, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                    std::vector<unsigned char>(UPDATE_BYTES, updateOf(i)));
+            service.wait(ticket);
+
+            bool good = service.isDone(ticket);
+            service.forget(ticket);
+            if (good)
+            {
+                unsigned int issued = GLState::getThisFrame().issued;
+                readBack(i, objects[i], bytes);
+                good = GLState::getThisFrame().issued != issued;
+            }
+
+            for (size_t b = 0; good && b < bytes.size(); ++b)
+                good = bytes[b] == (b < UPDATE_BYTES ? updateOf(i) : fillOf(i));
+            if (!good)
+            {
+                printf("update %d did not read back\n", i);
+                ++updateFailures;
+            }
+
+            if (i % 2 == 0)
+            {
+                glDeleteBuffers(1, &objects[i]);
+                GLState::forgetBuffer(objects[i]);
+            }
+            else
+            {
+                glDeleteTextures(1, &objects[i]);
+                GLState::forgetTexture(objects[i]);
+            }
+        }
+
+        printf("%d updates, %d failed\n", uploads, updateFailures);
+        failures += updateFailures;
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, uploadContext);
+    eglDestroyContext(display, mainContext);
+    eglTerminate(display);
+    return failures ? 1 : 0;
+}
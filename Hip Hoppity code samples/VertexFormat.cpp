@@ -0,0 +1,135 @@
+/*
+ * file: VertexFormat.cpp
+ * author: Mark Kouris
+ * brief: the implementation of the VertexFormat class,
+ *        this packs attribute values and issues the attribute pointers.
+ */
+
+#include "VertexFormat.h"
+#include <cmath>   // std::round
+#include <cstring> // std::memcpy
+
+/* Use Notes:
+
+Normalized values are clamped before packing, so a uv of 1.0001 becomes 1
+instead of wrapping to 0. Half floats round to nearest even, values too
+large for a half become infinity and values too small become zero.
+
+*/
+
+//helper, clamps then scales to the integer range
+static float clamp(float value, float low, float high)
+{
+    return value < low ? low : (value > high ? high : value);
+}
+
+Half2::Half2(float x, float y) : x(VertexFormat::toHalf(x)), y(VertexFormat::toHalf(y))
+{
+}
+
+Half4::Half4(float x, float y, float z, float w) :
+    x(VertexFormat::toHalf(x)), y(VertexFormat::toHalf(y)), z(VertexFormat::toHalf(z)), w(VertexFormat::toHalf(w))
+{
+}
+
+Norm16x2::Norm16x2(float x, float y) :
+    x((int16_t)std::round(clamp(x, -1.f, 1.f) * 32767.f)), y((int16_t)std::round(clamp(y, -1.f, 1.f) * 32767.f))
+{
+}
+
+UNorm16x2::UNorm16x2(float x, float y) :
+    x((uint16_t)std::round(clamp(x, 0.f, 1.f) * 65535.f)), y((uint16_t)std::round(clamp(y, 0.f, 1.f) * 65535.f))
+{
+}
+
+UNorm8x4::UNorm8x4(float r, float g, float b, float a) :
+    r((uint8_t)std::round(clamp(r, 0.f, 1.f) * 255.f)), g((uint8_t)std::round(clamp(g, 0.f, 1.f) * 255.f)),
+    b((uint8_t)std::round(clamp(b, 0.f, 1.f) * 255.f)), a((uint8_t)std::round(clamp(a, 0.f, 1.f) * 255.f))
+{
+}
+
+uint16_t VertexFormat::toHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    //infinity and NaN keep their kind, NaN keeps a mantissa bit so it stays NaN
+    if (exponent == 0xFF)
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+
+    int halfExponent = (int)exponent - 127 + 15;
+    if (halfExponent >= 31)
+        return sign | 0x7C00;
+
+    //too small for a normal half, shift the mantissa into a subnormal or lose it
+    if (halfExponent <= 0)
+    {
+        if (halfExponent < -10)
+            return sign;
+
+        mantissa |= 0x800000; //the implicit leading 1
+        uint32_t shift = (uint32_t)(14 - halfExponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            ++half;
+        return sign | (uint16_t)half;
+    }
+
+    //round the 23 bit mantissa to 10 bits, a carry moves into the exponent on its own
+    uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        ++half;
+    return sign | (uint16_t)half;
+}
+
+float VertexFormat::fromHalf(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 0x1F)
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    else if (exponent != 0)
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    else if (mantissa == 0)
+        bits = sign;
+    else
+    {
+        //subnormal half, normalize it for the float
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400))
+        {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void VertexFormat::enable(const VertexAttribute& attribute, GLsizei stride, size_t bufferOffset,
+    unsigned int divisor)
+{
+    void* pointer = (void*)(bufferOffset + attribute.offset);
+
+    if (attribute.integer)
+        glVertexAttribIPointer(attribute.location, attribute.components, attribute.type, stride, pointer);
+    else
+        glVertexAttribPointer(attribute.location, attribute.components, attribute.type,
+            attribute.normalized ? GL_TRUE : GL_FALSE, stride, pointer);
+
+    glVertexAttribDivisor(attribute.location, divisor);
+    glEnableVertexAttribArray(attribute.location);
+}
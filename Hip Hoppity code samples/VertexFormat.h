@@ -0,0 +1,184 @@
+/*
+ * file: VertexFormat.h
+ * author: Mark Kouris
+ * brief: the interface of the VertexFormat class.
+ *        Vertex structs describe their attributes once, by member and shader
+ *        location, and the GL type, component count, offset and stride are
+ *        worked out from the member types at compile time. Packed types
+ *        (half floats, normalized shorts and bytes) are attribute types too.
+ *
+ */
+#pragma once
+#include <glad/glad.h>
+#include "glm/glm/glm.hpp"
+#include <array>
+#include <cstddef>  // offsetof, size_t
+#include <cstdint>
+#include <type_traits>
+
+/* Use Notes:
+
+A vertex struct lists its attributes in a static layout() function, the
+member function body sees the finished struct so offsetof works there:
+
+    struct SpriteVertex
+    {
+        glm::vec2 position; // location 0, 8 bytes
+        UNorm16x2 uv;       // location 2, 4 bytes, 0 to 1 in 1/65535 steps
+
+        static constexpr std::array<VertexAttribute, 2> layout()
+        {
+            return {{ VERTEX_ATTRIBUTE(SpriteVertex, position, 0),
+                      VERTEX_ATTRIBUTE(SpriteVertex, uv, 2) }};
+        }
+    };
+
+    GLState::bindVertexArray(VAO);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
+    VertexFormat::apply<SpriteVertex>(); //every glVertexAttribPointer, stride 12
+
+Shaders do not change for packed types, a UNorm16x2 still arrives as a vec2
+and a vec2 position arrives in a vec3 input with z = 0. A member type with no
+AttributeTraits, or an attribute that does not fit its struct, fails to
+compile.
+
+*/
+
+//two 16 bit floats, good to about 3 decimal digits, any range a float has
+struct Half2
+{
+    uint16_t x = 0, y = 0;
+
+    Half2() = default;
+    Half2(float x, float y);
+};
+
+//four 16 bit floats
+struct Half4
+{
+    uint16_t x = 0, y = 0, z = 0, w = 0;
+
+    Half4() = default;
+    Half4(float x, float y, float z, float w);
+};
+
+//-1 to 1 in 16 bits each, normals and tangents
+struct Norm16x2
+{
+    int16_t x = 0, y = 0;
+
+    Norm16x2() = default;
+    Norm16x2(float x, float y);
+};
+
+//0 to 1 in 16 bits each, texture coordinates that stay inside the texture
+struct UNorm16x2
+{
+    uint16_t x = 0, y = 0;
+
+    UNorm16x2() = default;
+    UNorm16x2(float x, float y);
+};
+
+//0 to 1 in 8 bits each, colors
+struct UNorm8x4
+{
+    uint8_t r = 0, g = 0, b = 0, a = 0;
+
+    UNorm8x4() = default;
+    UNorm8x4(float r, float g, float b, float a = 1.0f);
+};
+
+//what GL needs to know about one member type, specialized below for every supported type
+template <typename T>
+struct AttributeTraits;
+
+#define ATTRIBUTE_TRAITS(Type, Components, GLType, Normalized, Integer) \
+    template <> struct AttributeTraits<Type>                           \
+    {                                                                  \
+        static constexpr int components = Components;                  \
+        static constexpr GLenum type = GLType;                         \
+        static constexpr bool normalized = Normalized;                 \
+        static constexpr bool integer = Integer;                       \
+    };
+
+ATTRIBUTE_TRAITS(float,      1, GL_FLOAT,          false, false)
+ATTRIBUTE_TRAITS(glm::vec2,  2, GL_FLOAT,          false, false)
+ATTRIBUTE_TRAITS(glm::vec3,  3, GL_FLOAT,          false, false)
+ATTRIBUTE_TRAITS(glm::vec4,  4, GL_FLOAT,          false, false)
+ATTRIBUTE_TRAITS(Half2,      2, GL_HALF_FLOAT,     false, false)
+ATTRIBUTE_TRAITS(Half4,      4, GL_HALF_FLOAT,     false, false)
+ATTRIBUTE_TRAITS(Norm16x2,   2, GL_SHORT,          true,  false)
+ATTRIBUTE_TRAITS(UNorm16x2,  2, GL_UNSIGNED_SHORT, true,  false)
+ATTRIBUTE_TRAITS(UNorm8x4,   4, GL_UNSIGNED_BYTE,  true,  false)
+ATTRIBUTE_TRAITS(uint32_t,   1, GL_UNSIGNED_INT,   false, true)  //ids, read as uint in the shader
+
+#undef ATTRIBUTE_TRAITS
+
+struct VertexAttribute
+{
+    unsigned int location; // layout (location = N) in the shader
+    int components;        // 1 to 4
+    GLenum type;           // GL type of one component
+    bool normalized;       // integers read as 0 to 1 or -1 to 1
+    bool integer;          // read with glVertexAttribIPointer, as int or uint
+    size_t offset;         // bytes from the start of the vertex
+    size_t size;           // bytes the member takes
+};
+
+//one attribute from a member, Vertex must be complete, so use it inside layout()
+#define VERTEX_ATTRIBUTE(Vertex, member, location) \
+    VertexFormat::attribute<decltype(Vertex::member)>(location, offsetof(Vertex, member))
+
+class VertexFormat
+{
+public:
+    template <typename T>
+    static constexpr VertexAttribute attribute(unsigned int location, size_t offset)
+    {
+        return { location, AttributeTraits<T>::components, AttributeTraits<T>::type,
+                 AttributeTraits<T>::normalized, AttributeTraits<T>::integer, offset, sizeof(T) };
+    }
+
+    //true when every attribute is inside the vertex and no two share bytes or a location
+    template <typename Vertex>
+    static constexpr bool isValid()
+    {
+        constexpr auto attributes = Vertex::layout();
+        for (size_t i = 0; i < attributes.size(); ++i)
+        {
+            if (attributes[i].offset + attributes[i].size > sizeof(Vertex))
+                return false;
+
+            for (size_t j = i + 1; j < attributes.size(); ++j)
+            {
+                if (attributes[i].location == attributes[j].location)
+                    return false;
+                if (attributes[i].offset < attributes[j].offset + attributes[j].size &&
+                    attributes[j].offset < attributes[i].offset + attributes[i].size)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    //sets up and enables every attribute of Vertex for the buffer bound to GL_ARRAY_BUFFER,
+    //divisor 1 makes them per instance
+    template <typename Vertex>
+    static void apply(size_t bufferOffset = 0, unsigned int divisor = 0)
+    {
+        static_assert(std::is_standard_layout<Vertex>::value, "vertex must be standard layout for offsetof");
+        static_assert(isValid<Vertex>(), "vertex attributes overlap, repeat a location or do not fit");
+
+        constexpr auto attributes = Vertex::layout();
+        for (const VertexAttribute& a : attributes)
+            enable(a, (GLsizei)sizeof(Vertex), bufferOffset, divisor);
+    }
+
+    //float to half bits, rounds to nearest and keeps infinities
+    static uint16_t toHalf(float value);
+    static float fromHalf(uint16_t half);
+
+private:
+    static void enable(const VertexAttribute& attribute, GLsizei stride, size_t bufferOffset, unsigned int divisor);
+};
@@ -0,0 +1,357 @@
+/* Start Header -------------------------------------------------------
+File Name: Frustum.cpp
+Purpose: This file serves as the definition for the frustum class, plane extraction
+and the SIMD culling loops.
+Language: C++ and msvc compiler
+Platform: Most up to date version of msvc compiler, opengl ver450. Only works on windows.
+Author: Mark Kouris
+End Header --------------------------------------------------------*/
+
+#include "Frustum.h"
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h> // SSE2
+#if defined(__AVX__)
+#include <immintrin.h> // AVX, build with /arch:AVX or -mavx to get the 8 wide loops
+#endif
+
+//helper for the batch tests, popcount without relying on a compiler builtin
+static size_t countBits(uint32_t mask)
+{
+    size_t bits = 0;
+    for (; mask; mask &= mask - 1)
+        ++bits;
+    return bits;
+}
+
+/**
+ * @brief Construct a frustum that contains everything
+ *
+ */
+Frustum::Frustum()
+{
+    for (int i = 0; i < PLANE_COUNT; ++i)
+        setPlane(i, glm::vec4(0, 0, 0, 1));
+}
+
+/**
+ * @brief Extracts the planes from a view projection matrix (Gribb/Hartmann).
+ * each plane is the w row plus or minus one of the other rows
+ *
+ * @param viewProjection
+ */
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+    const glm::mat4& m = viewProjection;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    setPlane(LEFT_PLANE, row3 + row0);
+    setPlane(RIGHT_PLANE, row3 - row0);
+    setPlane(BOTTOM_PLANE, row3 + row1);
+    setPlane(TOP_PLANE, row3 - row1);
+    setPlane(NEAR_PLANE, row3 + row2);
+    setPlane(FAR_PLANE, row3 - row2);
+}
+
+/**
+ * @brief Builds the planes straight from a camera basis.
+ * the viewport holds width, height and distance of the view plane,
+ * which gives the slope of the side planes
+ *
+ * @param eye
+ * @param right
+ * @param up
+ * @param back
+ * @param viewport
+ * @param nearDistance
+ * @param farDistance
+ */
+Frustum::Frustum(const glm::vec4& eye, const glm::vec4& right, const glm::vec4& up, const glm::vec4& back,
+                 const glm::vec4& viewport, float nearDistance, float farDistance)
+{
+    glm::vec3 E(eye);
+    glm::vec3 u = glm::normalize(glm::vec3(right));
+    glm::vec3 v = glm::normalize(glm::vec3(up));
+    glm::vec3 n = glm::normalize(glm::vec3(back));
+    glm::vec3 forward = -n;
+
+    float halfWidth = viewport.x / 2;
+    float halfHeight = viewport.y / 2;
+    float distance = viewport.z;
+
+    // inward normals of the side planes, all of them go through the eye
+    glm::vec3 leftN = glm::normalize(distance * u + halfWidth * forward);
+    glm::vec3 rightN = glm::normalize(-distance * u + halfWidth * forward);
+    glm::vec3 bottomN = glm::normalize(distance * v + halfHeight * forward);
+    glm::vec3 topN = glm::normalize(-distance * v + halfHeight * forward);
+
+    setPlane(LEFT_PLANE, glm::vec4(leftN, -glm::dot(leftN, E)));
+    setPlane(RIGHT_PLANE, glm::vec4(rightN, -glm::dot(rightN, E)));
+    setPlane(BOTTOM_PLANE, glm::vec4(bottomN, -glm::dot(bottomN, E)));
+    setPlane(TOP_PLANE, glm::vec4(topN, -glm::dot(topN, E)));
+    setPlane(NEAR_PLANE, glm::vec4(forward, -glm::dot(forward, E) - nearDistance));
+    setPlane(FAR_PLANE, glm::vec4(n, glm::dot(forward, E) + farDistance));
+}
+
+/**
+ * @brief tests one box, true when it is at least partly inside
+ *
+ * @param min
+ * @param max
+ * @return bool
+ */
+bool Frustum::testAABB(const glm::vec3& min, const glm::vec3& max) const
+{
+    glm::vec3 center = (min + max) * 0.5f;
+    glm::vec3 extent = (max - min) * 0.5f;
+
+    for (int i = 0; i < PLANE_COUNT; ++i)
+    {
+        float distance = glm::dot(glm::vec3(planes[i]), center) + planes[i].w;
+        float radius = glm::dot(glm::vec3(absNormals[i]), extent);
+        if (distance + radius < 0)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief tests one sphere, true when it is at least partly inside
+ *
+ * @param center
+ * @param radius
+ * @return bool
+ */
+bool Frustum::testSphere(const glm::vec3& center, float radius) const
+{
+    for (int i = 0; i < PLANE_COUNT; ++i)
+    {
+        if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w + radius < 0)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief culls boxes given as min/max pairs.
+ * boxes are turned into center/extent and transposed into registers,
+ * then every plane is tested against all lanes at once
+ *
+ * @param boxes
+ * @param count
+ * @param visibleBits
+ * @return size_t
+ */
+size_t Frustum::cullAABBs(const glm::vec4* boxes, size_t count, uint32_t* visibleBits) const
+{
+    memset(visibleBits, 0, ((count + 31) / 32) * sizeof(uint32_t));
+    size_t visible = 0;
+    size_t i = 0;
+
+#if defined(__AVX__)
+    for (; i + 8 <= count; i += 8)
+    {
+        const glm::vec4* b = boxes + i * 2;
+        __m256 minX = _mm256_setr_ps(b[0].x, b[2].x, b[4].x, b[6].x, b[8].x, b[10].x, b[12].x, b[14].x);
+        __m256 minY = _mm256_setr_ps(b[0].y, b[2].y, b[4].y, b[6].y, b[8].y, b[10].y, b[12].y, b[14].y);
+        __m256 minZ = _mm256_setr_ps(b[0].z, b[2].z, b[4].z, b[6].z, b[8].z, b[10].z, b[12].z, b[14].z);
+        __m256 maxX = _mm256_setr_ps(b[1].x, b[3].x, b[5].x, b[7].x, b[9].x, b[11].x, b[13].x, b[15].x);
+        __m256 maxY = _mm256_setr_ps(b[1].y, b[3].y, b[5].y, b[7].y, b[9].y, b[11].y, b[13].y, b[15].y);
+        __m256 maxZ = _mm256_setr_ps(b[1].z, b[3].z, b[5].z, b[7].z, b[9].z, b[11].z, b[13].z, b[15].z);
+
+        __m256 half = _mm256_set1_ps(0.5f);
+        __m256 cx = _mm256_mul_ps(_mm256_add_ps(minX, maxX), half);
+        __m256 cy = _mm256_mul_ps(_mm256_add_ps(minY, maxY), half);
+        __m256 cz = _mm256_mul_ps(_mm256_add_ps(minZ, maxZ), half);
+        __m256 ex = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half);
+        __m256 ey = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half);
+        __m256 ez = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half);
+
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < PLANE_COUNT; ++p)
+        {
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[p].x), cx), _mm256_mul_ps(_mm256_set1_ps(planes[p].y), cy)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[p].z), cz), _mm256_set1_ps(planes[p].w)));
+            __m256 radius = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(absNormals[p].x), ex), _mm256_mul_ps(_mm256_set1_ps(absNormals[p].y), ey)),
+                _mm256_mul_ps(_mm256_set1_ps(absNormals[p].z), ez));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+
+        uint32_t mask = ~(uint32_t)_mm256_movemask_ps(outside) & 0xFF;
+        visibleBits[i / 32] |= mask << (i % 32);
+        visible += countBits(mask);
+    }
+#endif
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const glm::vec4* b = boxes + i * 2;
+        // corners are vec4, so four of them are one 4x4 transpose
+        __m128 minX = _mm_loadu_ps(&b[0].x);
+        __m128 minY = _mm_loadu_ps(&b[2].x);
+        __m128 minZ = _mm_loadu_ps(&b[4].x);
+        __m128 minW = _mm_loadu_ps(&b[6].x);
+        _MM_TRANSPOSE4_PS(minX, minY, minZ, minW);
+        __m128 maxX = _mm_loadu_ps(&b[1].x);
+        __m128 maxY = _mm_loadu_ps(&b[3].x);
+        __m128 maxZ = _mm_loadu_ps(&b[5].x);
+        __m128 maxW = _mm_loadu_ps(&b[7].x);
+        _MM_TRANSPOSE4_PS(maxX, maxY, maxZ, maxW);
+
+        __m128 half = _mm_set1_ps(0.5f);
+        __m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+        __m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+        __m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+        __m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+        __m128 ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+        __m128 ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < PLANE_COUNT; ++p)
+        {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].x), cx), _mm_mul_ps(_mm_set1_ps(planes[p].y), cy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].z), cz), _mm_set1_ps(planes[p].w)));
+            __m128 radius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(absNormals[p].x), ex), _mm_mul_ps(_mm_set1_ps(absNormals[p].y), ey)),
+                _mm_mul_ps(_mm_set1_ps(absNormals[p].z), ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+
+        uint32_t mask = ~(uint32_t)_mm_movemask_ps(outside) & 0xF;
+        visibleBits[i / 32] |= mask << (i % 32);
+        visible += countBits(mask);
+    }
+
+    // leftovers that do not fill a register
+    for (; i < count; ++i)
+    {
+        if (testAABB(glm::vec3(boxes[i * 2]), glm::vec3(boxes[i * 2 + 1])))
+        {
+            visibleBits[i / 32] |= 1u << (i % 32);
+            ++visible;
+        }
+    }
+
+    return visible;
+}
+
+/**
+ * @brief culls spheres given as xyz center and w radius.
+ * four spheres are exactly one 4x4 transpose, so the loads stay aligned to vec4
+ *
+ * @param spheres
+ * @param count
+ * @param visibleBits
+ * @return size_t
+ */
+size_t Frustum::cullSpheres(const glm::vec4* spheres, size_t count, uint32_t* visibleBits) const
+{
+    memset(visibleBits, 0, ((count + 31) / 32) * sizeof(uint32_t));
+    size_t visible = 0;
+    size_t i = 0;
+
+#if defined(__AVX__)
+    for (; i + 8 <= count; i += 8)
+    {
+        const float* s = &spheres[i].x;
+        __m256 row0 = _mm256_loadu_ps(s);      // x0 y0 z0 r0 x1 y1 z1 r1
+        __m256 row1 = _mm256_loadu_ps(s + 8);  // spheres 2 and 3
+        __m256 row2 = _mm256_loadu_ps(s + 16); // spheres 4 and 5
+        __m256 row3 = _mm256_loadu_ps(s + 24); // spheres 6 and 7
+
+        // 4x4 transpose in each 128 bit half, lanes end up as 0 2 4 6 1 3 5 7
+        __m256 t0 = _mm256_unpacklo_ps(row0, row1);
+        __m256 t1 = _mm256_unpackhi_ps(row0, row1);
+        __m256 t2 = _mm256_unpacklo_ps(row2, row3);
+        __m256 t3 = _mm256_unpackhi_ps(row2, row3);
+        __m256 cx = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 cy = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 cz = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 r = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < PLANE_COUNT; ++p)
+        {
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[p].x), cx), _mm256_mul_ps(_mm256_set1_ps(planes[p].y), cy)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[p].z), cz), _mm256_set1_ps(planes[p].w)));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, r), _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+
+        // undo the lane order, bit k of the movemask belongs to sphere order[k]
+        uint32_t lanes = ~(uint32_t)_mm256_movemask_ps(outside) & 0xFF;
+        static const int order[8] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+        uint32_t mask = 0;
+        for (int k = 0; k < 8; ++k)
+            mask |= ((lanes >> k) & 1) << order[k];
+
+        visibleBits[i / 32] |= mask << (i % 32);
+        visible += countBits(mask);
+    }
+#endif
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const float* s = &spheres[i].x;
+        __m128 cx = _mm_loadu_ps(s);
+        __m128 cy = _mm_loadu_ps(s + 4);
+        __m128 cz = _mm_loadu_ps(s + 8);
+        __m128 r = _mm_loadu_ps(s + 12);
+        _MM_TRANSPOSE4_PS(cx, cy, cz, r);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < PLANE_COUNT; ++p)
+        {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].x), cx), _mm_mul_ps(_mm_set1_ps(planes[p].y), cy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].z), cz), _mm_set1_ps(planes[p].w)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, r), _mm_setzero_ps()));
+        }
+
+        uint32_t mask = ~(uint32_t)_mm_movemask_ps(outside) & 0xF;
+        visibleBits[i / 32] |= mask << (i % 32);
+        visible += countBits(mask);
+    }
+
+    // leftovers that do not fill a register
+    for (; i < count; ++i)
+    {
+        if (testSphere(glm::vec3(spheres[i]), spheres[i].w))
+        {
+            visibleBits[i / 32] |= 1u << (i % 32);
+            ++visible;
+        }
+    }
+
+    return visible;
+}
+
+/**
+ * @brief gets one of the planes, xyz is the inward normal
+ *
+ * @param which
+ * @return const glm::vec4&
+ */
+const glm::vec4& Frustum::plane(Plane which) const
+{
+    return planes[which];
+}
+
+/**
+ * @brief normalizes and stores a plane, so distances come out in world units
+ *
+ * @param index
+ * @param plane
+ */
+void Frustum::setPlane(int index, const glm::vec4& plane)
+{
+    float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    planes[index] = length > 0 ? plane / length : plane;
+    absNormals[index] = glm::vec4(fabsf(planes[index].x), fabsf(planes[index].y), fabsf(planes[index].z), 0);
+}
@@ -0,0 +1,53 @@
+/* Start Header -------------------------------------------------------
+File Name: Frustum.h
+Purpose: This file serves as the header for the frustum class. It holds the six
+view planes of a camera and culls batches of bounding boxes and spheres against them.
+Language: C++ and msvc compiler
+Platform: Most up to date version of msvc compiler, opengl ver450. Only works on windows.
+Author: Mark Kouris
+End Header --------------------------------------------------------*/
+
+#pragma once
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+class Frustum
+{
+public:
+    enum Plane { LEFT_PLANE, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+    Frustum();
+
+    // planes of any view projection matrix, normals point inwards
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    // planes of a camera given by its basis, for the advanced camera:
+    // Frustum(cam.eye(), cam.right(), cam.up(), cam.back(), cam.viewport(), cam.nearf(), cam.farf())
+    Frustum(const glm::vec4& eye, const glm::vec4& right, const glm::vec4& up, const glm::vec4& back,
+            const glm::vec4& viewport, float nearDistance, float farDistance);
+
+    // single tests
+    bool testAABB(const glm::vec3& min, const glm::vec3& max) const;
+    bool testSphere(const glm::vec3& center, float radius) const;
+
+    // batch tests, 4 or 8 objects at a time depending on the instruction set.
+    // boxes are min/max vec4 pairs laid out like Mesh::boundingBox (w is ignored), spheres are xyz center and w radius.
+    // bit i of visibleBits is set when object i is at least partly inside,
+    // visibleBits must hold (count + 31) / 32 words. Returns how many are visible
+    size_t cullAABBs(const glm::vec4* boxes, size_t count, uint32_t* visibleBits) const;
+    size_t cullSpheres(const glm::vec4* spheres, size_t count, uint32_t* visibleBits) const;
+
+    const glm::vec4& plane(Plane which) const;
+
+private:
+    void setPlane(int index, const glm::vec4& plane);
+
+    glm::vec4 planes[PLANE_COUNT];        // xyz normal, w distance, normalized
+    glm::vec4 absNormals[PLANE_COUNT];    // |normal|, used to project box extents
+};
+
+#endif
@@ -0,0 +1,591 @@
+/* Start Header -------------------------------------------------------
+File Name: OcclusionCuller.cpp
+Purpose: This file serves as the definition for the occlusion culler class, the
+occluder simplification, the tiled SSE rasterizer and the hierarchy tests.
+Language: C++ and msvc compiler
+Platform: Most up to date version of msvc compiler, opengl ver450. Only works on windows.
+Author: Mark Kouris
+End Header --------------------------------------------------------*/
+
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <emmintrin.h> // SSE2
+
+/*
+ * Depth is stored as window depth, 0 at the near plane and 1 at the far plane,
+ * in 4x4 pixel tiles so every tile row is one SSE register. std::vector gives
+ * no 16 byte alignment guarantee, so tile rows use the unaligned load/store.
+ *
+ * Occluders are rasterized at pixel centers with interpolated depth, keeping the
+ * nearest value. Triangles crossing the near plane are skipped instead of clipped,
+ * which only ever leaves pixels empty (far), so the buffer never hides too much.
+ *
+ * Level 0 of the hierarchy holds the farthest depth of each tile and every level
+ * above the farthest of 2x2 texels below it. A box is hidden when its nearest
+ * corner is farther than the farthest occluder depth over its whole screen rect.
+ */
+
+//helper, timer for the stats
+static float microsecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief keeps the largest triangles of a mesh, then drops unused vertices
+ *
+ * @param mesh
+ * @param maxTriangles
+ * @return OcclusionCuller::Occluder
+ */
+OcclusionCuller::Occluder OcclusionCuller::simplify(const Mesh& mesh, size_t maxTriangles)
+{
+    size_t triangleCount = mesh.vertexIndices.size() / 3;
+    std::vector<std::pair<float, size_t>> areas(triangleCount);
+
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        glm::vec3 a(mesh.vertexBuffer[mesh.vertexIndices[t * 3]]);
+        glm::vec3 b(mesh.vertexBuffer[mesh.vertexIndices[t * 3 + 1]]);
+        glm::vec3 c(mesh.vertexBuffer[mesh.vertexIndices[t * 3 + 2]]);
+        areas[t] = std::make_pair(glm::length(glm::cross(b - a, c - a)), t);
+    }
+
+    size_t kept = std::min(maxTriangles, triangleCount);
+    std::partial_sort(areas.begin(), areas.begin() + kept, areas.end(),
+        [](const std::pair<float, size_t>& l, const std::pair<float, size_t>& r) { return l.first > r.first; });
+
+    Occluder occluder;
+    std::vector<int> remap(mesh.vertexBuffer.size(), -1);
+
+    for (size_t k = 0; k < kept; ++k)
+    {
+        size_t t = areas[k].second;
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            unsigned int index = mesh.vertexIndices[t * 3 + corner];
+            if (remap[index] < 0)
+            {
+                remap[index] = (int)occluder.positions.size();
+                occluder.positions.push_back(glm::vec4(glm::vec3(mesh.vertexBuffer[index]), 1.0f));
+            }
+            occluder.indices.push_back((unsigned int)remap[index]);
+        }
+    }
+
+    return occluder;
+}
+
+/**
+ * @brief Construct a new culler, starts the worker threads
+ *
+ * @param width
+ * @param height
+ * @param threads
+ */
+OcclusionCuller::OcclusionCuller(int width, int height, unsigned int threads)
+{
+    bufferWidth = (std::max(width, TILE_SIZE) + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+    bufferHeight = (std::max(height, TILE_SIZE) + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+    tilesX = bufferWidth / TILE_SIZE;
+    tilesY = bufferHeight / TILE_SIZE;
+    depth.assign((size_t)bufferWidth * bufferHeight, 1.0f);
+
+    // every level down to a single texel
+    int w = tilesX;
+    int h = tilesY;
+    while (true)
+    {
+        levelWidths.push_back(w);
+        levelHeights.push_back(h);
+        hierarchy.emplace_back((size_t)w * h, 1.0f);
+        if (w == 1 && h == 1)
+            break;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+
+    threadCount = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, (unsigned int)tilesY);
+    for (unsigned int i = 1; i < threadCount; ++i)
+        workers.emplace_back(&OcclusionCuller::workerLoop, this, i);
+
+    viewProj = glm::mat4(1.0f);
+}
+
+/**
+ * @brief Destroy the culler, stops the worker threads
+ *
+ */
+OcclusionCuller::~OcclusionCuller()
+{
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        quitting = true;
+    }
+    wake.notify_all();
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+/**
+ * @brief clears the buffer and the queued occluders for a new camera
+ *
+ * @param viewProjection
+ */
+void OcclusionCuller::beginFrame(const glm::mat4& viewProjection)
+{
+    viewProj = viewProjection;
+    occluders.clear();
+    stats = Stats();
+    std::fill(depth.begin(), depth.end(), 1.0f);
+}
+
+/**
+ * @brief queues an occluder for this frame
+ *
+ * @param occluder
+ * @param model
+ */
+void OcclusionCuller::addOccluder(const Occluder& occluder, const glm::mat4& model)
+{
+    occluders.emplace_back(&occluder, model);
+}
+
+/**
+ * @brief transforms the occluders to screen space, rasterizes them in horizontal
+ * bands (one per thread, so no two threads ever touch the same tile) and builds the hierarchy
+ *
+ */
+void OcclusionCuller::rasterize()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    triangles.clear();
+
+    std::vector<glm::vec4> clip;
+    for (const auto& entry : occluders)
+    {
+        const Occluder& occluder = *entry.first;
+        glm::mat4 mvp = viewProj * entry.second;
+
+        clip.resize(occluder.positions.size());
+        for (size_t i = 0; i < clip.size(); ++i)
+            clip[i] = mvp * occluder.positions[i];
+
+        stats.occluderTriangles += occluder.indices.size() / 3;
+
+        for (size_t t = 0; t + 2 < occluder.indices.size(); t += 3)
+        {
+            triangle tri;
+            bool usable = true;
+
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                const glm::vec4& c = clip[occluder.indices[t + corner]];
+                if (c.w <= 1e-5f || c.z < -c.w)
+                {
+                    usable = false;
+                    break;
+                }
+
+                tri.x[corner] = (c.x / c.w * 0.5f + 0.5f) * bufferWidth;
+                tri.y[corner] = (c.y / c.w * 0.5f + 0.5f) * bufferHeight;
+                tri.z[corner] = c.z / c.w * 0.5f + 0.5f;
+            }
+
+            if (!usable)
+                continue;
+
+            // off screen or entirely past the far plane
+            float minX = std::min(tri.x[0], std::min(tri.x[1], tri.x[2]));
+            float maxX = std::max(tri.x[0], std::max(tri.x[1], tri.x[2]));
+            float minY = std::min(tri.y[0], std::min(tri.y[1], tri.y[2]));
+            float maxY = std::max(tri.y[0], std::max(tri.y[1], tri.y[2]));
+            float minZ = std::min(tri.z[0], std::min(tri.z[1], tri.z[2]));
+            if (maxX < 0 || maxY < 0 || minX >= bufferWidth || minY >= bufferHeight || minZ > 1.0f)
+                continue;
+
+            triangles.push_back(tri);
+        }
+    }
+
+    stats.rasterizedTriangles = triangles.size();
+
+    int rowsPerBand = (tilesY + (int)threadCount - 1) / (int)threadCount * TILE_SIZE;
+    parallel([this, rowsPerBand](unsigned int worker)
+    {
+        int firstRow = (int)worker * rowsPerBand;
+        int lastRow = std::min(firstRow + rowsPerBand, bufferHeight) - 1;
+        if (firstRow <= lastRow)
+            rasterizeBand(firstRow, lastRow);
+    });
+
+    buildHierarchy();
+    stats.rasterMicroseconds = microsecondsSince(start);
+}
+
+/**
+ * @brief tests the boxes still marked visible, split across the threads in
+ * whole words of the bitmask so no two threads write the same word
+ *
+ * @param boxes
+ * @param count
+ * @param visibleBits
+ * @return size_t
+ */
+size_t OcclusionCuller::cullAABBs(const glm::vec4* boxes, size_t count, uint32_t* visibleBits)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    size_t words = (count + 31) / 32;
+    std::vector<size_t> tested(threadCount, 0);
+    std::vector<size_t> culled(threadCount, 0);
+
+    parallel([&](unsigned int worker)
+    {
+        size_t firstWord = words * worker / threadCount;
+        size_t lastWord = words * (worker + 1) / threadCount;
+
+        for (size_t word = firstWord; word < lastWord; ++word)
+        {
+            uint32_t bits = visibleBits[word];
+            int bitCount = (int)std::min<size_t>(32, count - word * 32);
+            for (int bit = 0; bit < bitCount; ++bit)
+            {
+                if (!((bits >> bit) & 1))
+                    continue;
+
+                size_t i = word * 32 + bit;
+                ++tested[worker];
+                if (!testAABB(boxes[i * 2], boxes[i * 2 + 1]))
+                {
+                    bits &= ~(1u << bit);
+                    ++culled[worker];
+                }
+            }
+            visibleBits[word] = bits;
+        }
+    });
+
+    for (unsigned int worker = 0; worker < threadCount; ++worker)
+    {
+        stats.tested += tested[worker];
+        stats.culled += culled[worker];
+    }
+
+    stats.testMicroseconds += microsecondsSince(start);
+    size_t visible = 0;
+    for (unsigned int worker = 0; worker < threadCount; ++worker)
+        visible += tested[worker] - culled[worker];
+    return visible;
+}
+
+/**
+ * @brief projects the box and compares its nearest depth against the farthest
+ * occluder depth under it, at a level where the rect covers at most 2x2 texels
+ *
+ * @param min
+ * @param max
+ * @return bool
+ */
+bool OcclusionCuller::testAABB(const glm::vec4& min, const glm::vec4& max) const
+{
+    // the eight corners as two registers of four, one for the near z face and one
+    // for the far, lanes walk min/max x and y. Each clip component is then one
+    // row of the matrix applied to all four lanes at once
+    const float* m = &viewProj[0][0];
+    __m128 cornerX = _mm_setr_ps(min.x, max.x, min.x, max.x);
+    __m128 cornerY = _mm_setr_ps(min.y, min.y, max.y, max.y);
+    __m128 lowZ = _mm_set1_ps(min.z);
+    __m128 highZ = _mm_set1_ps(max.z);
+
+    __m128 low[4], high[4];
+    for (int row = 0; row < 4; ++row)
+    {
+        __m128 xy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[row]), cornerX),
+                                          _mm_mul_ps(_mm_set1_ps(m[4 + row]), cornerY)),
+                               _mm_set1_ps(m[12 + row]));
+        __m128 zColumn = _mm_set1_ps(m[8 + row]);
+        low[row] = _mm_add_ps(xy, _mm_mul_ps(zColumn, lowZ));
+        high[row] = _mm_add_ps(xy, _mm_mul_ps(zColumn, highZ));
+    }
+
+    // touching the near plane, too close to say anything
+    __m128 nearW = _mm_set1_ps(1e-5f);
+    __m128 zero = _mm_setzero_ps();
+    __m128 tooClose = _mm_or_ps(
+        _mm_or_ps(_mm_cmple_ps(low[3], nearW), _mm_cmplt_ps(low[2], _mm_sub_ps(zero, low[3]))),
+        _mm_or_ps(_mm_cmple_ps(high[3], nearW), _mm_cmplt_ps(high[2], _mm_sub_ps(zero, high[3]))));
+    if (_mm_movemask_ps(tooClose))
+        return true;
+
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 width = _mm_set1_ps((float)bufferWidth);
+    __m128 height = _mm_set1_ps((float)bufferHeight);
+    __m128 lowInverseW = _mm_div_ps(_mm_set1_ps(1.0f), low[3]);
+    __m128 highInverseW = _mm_div_ps(_mm_set1_ps(1.0f), high[3]);
+
+    __m128 lowX = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(low[0], lowInverseW), half), half), width);
+    __m128 highX = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(high[0], highInverseW), half), half), width);
+    __m128 lowY = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(low[1], lowInverseW), half), half), height);
+    __m128 highY = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(high[1], highInverseW), half), half), height);
+    __m128 lowDepth = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(low[2], lowInverseW), half), half);
+    __m128 highDepth = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(high[2], highInverseW), half), half);
+
+    // lanes are min x, max x, min y, max y, then nearest depth in a register of its own
+    __m128 mins = _mm_min_ps(_mm_unpacklo_ps(lowX, lowY), _mm_unpackhi_ps(lowX, lowY));
+    mins = _mm_min_ps(mins, _mm_min_ps(_mm_unpacklo_ps(highX, highY), _mm_unpackhi_ps(highX, highY)));
+    __m128 maxs = _mm_max_ps(_mm_unpacklo_ps(lowX, lowY), _mm_unpackhi_ps(lowX, lowY));
+    maxs = _mm_max_ps(maxs, _mm_max_ps(_mm_unpacklo_ps(highX, highY), _mm_unpackhi_ps(highX, highY)));
+    mins = _mm_min_ps(mins, _mm_movehl_ps(mins, mins)); // x in lane 0, y in lane 1
+    maxs = _mm_max_ps(maxs, _mm_movehl_ps(maxs, maxs));
+    __m128 depths = _mm_min_ps(lowDepth, highDepth);
+    depths = _mm_min_ps(depths, _mm_movehl_ps(depths, depths));
+    depths = _mm_min_ss(depths, _mm_shuffle_ps(depths, depths, _MM_SHUFFLE(1, 1, 1, 1)));
+
+    alignas(16) float lowest[4], highest[4];
+    _mm_store_ps(lowest, mins);
+    _mm_store_ps(highest, maxs);
+    float minX = lowest[0], minY = lowest[1];
+    float maxX = highest[0], maxY = highest[1];
+    float minZ = _mm_cvtss_f32(depths);
+
+    // off screen is the frustum's call, not ours
+    if (maxX < 0 || maxY < 0 || minX >= bufferWidth || minY >= bufferHeight)
+        return true;
+
+    int tx0 = std::max(0, (int)minX) / TILE_SIZE;
+    int ty0 = std::max(0, (int)minY) / TILE_SIZE;
+    int tx1 = std::min(bufferWidth - 1, (int)maxX) / TILE_SIZE;
+    int ty1 = std::min(bufferHeight - 1, (int)maxY) / TILE_SIZE;
+
+    // the first level where the span of tiles shifts down to 1 or 0 covers the rect with
+    // 2x2 texels unless it straddles a texel edge, then the one above always does
+    int span = std::max(tx1 - tx0, ty1 - ty0);
+    size_t level = 0;
+    while ((span >> level) > 1)
+        ++level;
+    if (level + 1 < hierarchy.size() && ((tx1 >> level) - (tx0 >> level) > 1 || (ty1 >> level) - (ty0 >> level) > 1))
+        ++level;
+
+    // the rect covers one or two texels each way, reading the corners covers both cases
+    const float* texels = hierarchy[level].data();
+    size_t levelWidth = (size_t)levelWidths[level];
+    size_t x0 = (size_t)(tx0 >> level), x1 = (size_t)(tx1 >> level);
+    size_t y0 = (size_t)(ty0 >> level) * levelWidth, y1 = (size_t)(ty1 >> level) * levelWidth;
+    float farthest = std::max(std::max(texels[y0 + x0], texels[y0 + x1]), std::max(texels[y1 + x0], texels[y1 + x1]));
+
+    return minZ <= farthest;
+}
+
+/**
+ * @brief gets the numbers of the current frame
+ *
+ * @return const OcclusionCuller::Stats&
+ */
+const OcclusionCuller::Stats& OcclusionCuller::getStats() const
+{
+    return stats;
+}
+
+int OcclusionCuller::width() const
+{
+    return bufferWidth;
+}
+
+int OcclusionCuller::height() const
+{
+    return bufferHeight;
+}
+
+float OcclusionCuller::depthAt(int x, int y) const
+{
+    size_t tile = (size_t)(y / TILE_SIZE) * tilesX + x / TILE_SIZE;
+    return depth[tile * TILE_SIZE * TILE_SIZE + (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE];
+}
+
+/**
+ * @brief rasterizes every triangle into rows firstRow..lastRow
+ *
+ * @param firstRow
+ * @param lastRow
+ */
+void OcclusionCuller::rasterizeBand(int firstRow, int lastRow)
+{
+    for (const triangle& tri : triangles)
+        rasterizeTriangle(tri, firstRow, lastRow);
+}
+
+/**
+ * @brief half space rasterizer, 4 pixels of a tile row at a time.
+ * edge functions and depth are planes in screen space, so each is a*x + b*y + c
+ *
+ * @param tri
+ * @param firstRow
+ * @param lastRow
+ */
+void OcclusionCuller::rasterizeTriangle(const triangle& tri, int firstRow, int lastRow)
+{
+    float x0 = tri.x[0], y0 = tri.y[0], z0 = tri.z[0];
+    float x1 = tri.x[1], y1 = tri.y[1], z1 = tri.z[1];
+    float x2 = tri.x[2], y2 = tri.y[2], z2 = tri.z[2];
+
+    // occluders are drawn from both sides, wind everything counter clockwise
+    float area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+    if (std::fabs(area) < 1e-8f)
+        return;
+    if (area < 0)
+    {
+        std::swap(x1, x2);
+        std::swap(y1, y2);
+        std::swap(z1, z2);
+        area = -area;
+    }
+
+    int minX = std::max(0, (int)std::floor(std::min(x0, std::min(x1, x2))));
+    int maxX = std::min(bufferWidth - 1, (int)std::ceil(std::max(x0, std::max(x1, x2))));
+    int minY = std::max(firstRow, (int)std::floor(std::min(y0, std::min(y1, y2))));
+    int maxY = std::min(lastRow, (int)std::ceil(std::max(y0, std::max(y1, y2))));
+    if (minX > maxX || minY > maxY)
+        return;
+
+    // edge(a, b) at p = (b.x - a.x)(p.y - a.y) - (b.y - a.y)(p.x - a.x), inside is >= 0
+    float a0 = -(y2 - y1), b0 = x2 - x1, c0 = (y2 - y1) * x1 - (x2 - x1) * y1;
+    float a1 = -(y0 - y2), b1 = x0 - x2, c1 = (y0 - y2) * x2 - (x0 - x2) * y2;
+    float a2 = -(y1 - y0), b2 = x1 - x0, c2 = (y1 - y0) * x0 - (x1 - x0) * y0;
+
+    // each edge function is the weight of the opposite vertex times the area
+    float inverseArea = 1.0f / area;
+    float za = (a0 * z0 + a1 * z1 + a2 * z2) * inverseArea;
+    float zb = (b0 * z0 + b1 * z1 + b2 * z2) * inverseArea;
+    float zc = (c0 * z0 + c1 * z1 + c2 * z2) * inverseArea;
+
+    __m128 zero = _mm_setzero_ps();
+    __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    __m128 edgeA0 = _mm_set1_ps(a0), edgeA1 = _mm_set1_ps(a1), edgeA2 = _mm_set1_ps(a2);
+    __m128 depthA = _mm_set1_ps(za);
+
+    int startX = minX & ~(TILE_SIZE - 1);
+    for (int y = minY; y <= maxY; ++y)
+    {
+        float py = y + 0.5f;
+        __m128 rowE0 = _mm_set1_ps(b0 * py + c0);
+        __m128 rowE1 = _mm_set1_ps(b1 * py + c1);
+        __m128 rowE2 = _mm_set1_ps(b2 * py + c2);
+        __m128 rowZ = _mm_set1_ps(zb * py + zc);
+        float* tileRow = &depth[((size_t)(y / TILE_SIZE) * tilesX) * TILE_SIZE * TILE_SIZE + (y % TILE_SIZE) * TILE_SIZE];
+
+        for (int x = startX; x <= maxX; x += TILE_SIZE)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(edgeA0, px), rowE0);
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(edgeA1, px), rowE1);
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(edgeA2, px), rowE2);
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+            if (_mm_movemask_ps(inside) == 0)
+                continue;
+
+            float* pixels = tileRow + (size_t)(x / TILE_SIZE) * TILE_SIZE * TILE_SIZE;
+            __m128 old = _mm_loadu_ps(pixels);
+            __m128 z = _mm_min_ps(old, _mm_add_ps(_mm_mul_ps(depthA, px), rowZ));
+            _mm_storeu_ps(pixels, _mm_or_ps(_mm_and_ps(inside, z), _mm_andnot_ps(inside, old)));
+        }
+    }
+}
+
+/**
+ * @brief farthest depth of every tile, then of every 2x2 block of the level below
+ *
+ */
+void OcclusionCuller::buildHierarchy()
+{
+    std::vector<float>& tiles = hierarchy[0];
+    for (int tile = 0; tile < tilesX * tilesY; ++tile)
+    {
+        const float* pixels = &depth[(size_t)tile * TILE_SIZE * TILE_SIZE];
+        __m128 farthest = _mm_max_ps(_mm_max_ps(_mm_loadu_ps(pixels), _mm_loadu_ps(pixels + 4)),
+                                     _mm_max_ps(_mm_loadu_ps(pixels + 8), _mm_loadu_ps(pixels + 12)));
+        farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+        farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+        tiles[tile] = _mm_cvtss_f32(farthest);
+    }
+
+    for (size_t level = 1; level < hierarchy.size(); ++level)
+    {
+        const std::vector<float>& below = hierarchy[level - 1];
+        int belowWidth = levelWidths[level - 1];
+        int belowHeight = levelHeights[level - 1];
+
+        for (int y = 0; y < levelHeights[level]; ++y)
+        {
+            for (int x = 0; x < levelWidths[level]; ++x)
+            {
+                // odd sizes repeat the last row or column
+                int x0 = x * 2, x1 = std::min(x * 2 + 1, belowWidth - 1);
+                int y0 = y * 2, y1 = std::min(y * 2 + 1, belowHeight - 1);
+                hierarchy[level][(size_t)y * levelWidths[level] + x] = std::max(
+                    std::max(below[(size_t)y0 * belowWidth + x0], below[(size_t)y0 * belowWidth + x1]),
+                    std::max(below[(size_t)y1 * belowWidth + x0], below[(size_t)y1 * belowWidth + x1]));
+            }
+        }
+    }
+}
+
+/**
+ * @brief runs a job on every thread, the calling thread is worker 0
+ *
+ * @param job
+ */
+void OcclusionCuller::parallel(const std::function<void(unsigned int)>& job)
+{
+    if (workers.empty())
+    {
+        job(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        currentJob = job;
+        remaining = (unsigned int)workers.size();
+        ++generation;
+    }
+    wake.notify_all();
+
+    job(0);
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+    done.wait(lock, [this] { return remaining == 0; });
+}
+
+/**
+ * @brief waits for jobs until the culler is destroyed
+ *
+ * @param worker
+ */
+void OcclusionCuller::workerLoop(unsigned int worker)
+{
+    unsigned int seen = 0;
+
+    while (true)
+    {
+        std::function<void(unsigned int)> job;
+        {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            wake.wait(lock, [this, seen] { return quitting || generation != seen; });
+            if (quitting)
+                return;
+            seen = generation;
+            job = currentJob;
+        }
+
+        job(worker);
+
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (--remaining == 0)
+            done.notify_one();
+    }
+}
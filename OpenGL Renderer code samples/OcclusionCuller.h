@@ -0,0 +1,123 @@
+/* Start Header -------------------------------------------------------
+File Name: OcclusionCuller.h
+Purpose: This file serves as the header for the occlusion culler class. It rasterizes
+a few simplified occluders into a small CPU depth buffer and tests bounding boxes
+against a max depth hierarchy built from it, so hidden objects are never drawn.
+Language: C++ and msvc compiler
+Platform: Most up to date version of msvc compiler, opengl ver450. Only works on windows.
+Author: Mark Kouris
+End Header --------------------------------------------------------*/
+
+#pragma once
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+class OcclusionCuller
+{
+public:
+    // a reduced copy of a mesh used only for rasterizing depth
+    struct Occluder
+    {
+        std::vector<glm::vec4> positions;   // object space, w = 1
+        std::vector<unsigned int> indices;  // three per triangle
+    };
+
+    struct Stats
+    {
+        size_t occluderTriangles = 0;   // triangles submitted this frame
+        size_t rasterizedTriangles = 0; // of those, triangles that reached the buffer
+        size_t tested = 0;              // boxes that were still visible when tested
+        size_t culled = 0;              // boxes found hidden
+        float rasterMicroseconds = 0;   // transform, rasterize and hierarchy
+        float testMicroseconds = 0;     // box tests
+    };
+
+    // keeps the largest triangles of an OBJReader mesh. A subset of the real surface
+    // never hides more than the mesh itself would, so culling stays conservative
+    static Occluder simplify(const Mesh& mesh, size_t maxTriangles = 256);
+
+    // width and height are rounded up to whole tiles, threads 0 uses every core
+    OcclusionCuller(int width = 320, int height = 192, unsigned int threads = 0);
+    ~OcclusionCuller();
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    // starts a frame from the camera, Camera::GetViewProjectionMatrix()
+    void beginFrame(const glm::mat4& viewProjection);
+
+    // queues an occluder, it is kept by pointer until rasterize() returns
+    void addOccluder(const Occluder& occluder, const glm::mat4& model);
+
+    // draws every queued occluder into the depth buffer and builds the hierarchy
+    void rasterize();
+
+    // boxes are world space min/max vec4 pairs. visibleBits comes in already filled,
+    // usually by Frustum::cullAABBs, and only set bits are tested; hidden boxes get
+    // their bit cleared. Returns how many are still visible
+    size_t cullAABBs(const glm::vec4* boxes, size_t count, uint32_t* visibleBits);
+
+    // single test, true when some part of the box might be visible
+    bool testAABB(const glm::vec4& min, const glm::vec4& max) const;
+
+    const Stats& getStats() const;
+    int width() const;
+    int height() const;
+    float depthAt(int x, int y) const; // for debug views, 0 near and 1 far
+
+private:
+    static const int TILE_SIZE = 4; // 4x4 pixels, one SSE register per tile row
+
+    struct triangle
+    {
+        float x[3];
+        float y[3];
+        float z[3];
+    };
+
+    void rasterizeBand(int firstRow, int lastRow);
+    void rasterizeTriangle(const triangle& tri, int firstRow, int lastRow);
+    void buildHierarchy();
+
+    // runs job(worker) on every worker and the calling thread, returns when all are done
+    void parallel(const std::function<void(unsigned int)>& job);
+    void workerLoop(unsigned int worker);
+
+    int bufferWidth;                              // pixels, multiple of TILE_SIZE
+    int bufferHeight;                             // pixels, multiple of TILE_SIZE
+    int tilesX;                                   // tiles per row
+    int tilesY;                                   // rows of tiles
+    std::vector<float> depth;                     // tiled, 16 floats per tile
+    std::vector<std::vector<float>> hierarchy;    // level 0 is one max per tile, then 2x2 maxes
+    std::vector<int> levelWidths;                 // texels per row of each level
+    std::vector<int> levelHeights;                // rows of each level
+
+    glm::mat4 viewProj;                           // camera of the current frame
+    std::vector<std::pair<const Occluder*, glm::mat4>> occluders; // queued this frame
+    std::vector<triangle> triangles;              // screen space triangles of this frame
+    Stats stats;
+
+    // small persistent pool, starting threads every frame would cost more than the work
+    unsigned int threadCount;                     // workers plus the calling thread
+    std::vector<std::thread> workers;
+    std::mutex poolMutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void(unsigned int)> currentJob;
+    unsigned int generation = 0;                  // bumped for every parallel() call
+    unsigned int remaining = 0;                   // workers still running the current job
+    bool quitting = false;
+};
+
+#endif
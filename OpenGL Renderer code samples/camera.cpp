@@ -8,6 +8,7 @@ Author: Mark Kouris
 End Header --------------------------------------------------------*/
 
 #include "camera.h"
+#include <glm/gtc/quaternion.hpp>
 
 //helper functions for camera functions
 float vecLen(const glm::vec4& vector);
@@ -17,6 +18,8 @@ glm::vec4 calcUpVec(glm::vec4& Nvec, glm::vec4& Uvec); //v vec
 float calcVPWidth(float FOV, float vpDist);
 float calcVPHeight(float width, float aspectRatio);
 glm::vec4 cross(const glm::vec4& u, const glm::vec4& v);
+glm::vec4 rotateVec(const glm::quat& rot, const glm::vec4& vector);
+void orthonormalize(glm::vec4& Nvec, glm::vec4& Uvec, glm::vec4& Vvec);
 
 
 /**
@@ -132,45 +135,49 @@ Camera& Camera::forward(float distance)
 
 /**
  * @brief rotates the camera along the y axis
- * multiplies the right and back vector by rot
+ * rotates the right and back vector by a quaternion about up
  * @param angle
  * @return Camera&
  */
 Camera& Camera::yaw(float angle)
 {
-    glm::mat4 yawRot = glm::rotate(angle, glm::vec3(up_vector.x, up_vector.y, up_vector.z));
-    right_vector = yawRot * right_vector;
-    back_vector = yawRot * back_vector;
+    //angleAxis expects a unit axis, the basis is only re-orthonormalized past a tolerance
+    glm::quat yawRot = glm::angleAxis(angle, glm::normalize(glm::vec3(up_vector)));
+    right_vector = rotateVec(yawRot, right_vector);
+    back_vector = rotateVec(yawRot, back_vector);
+    orthonormalize(back_vector, right_vector, up_vector);
     return *this;
 
 }
 
 /**
  * @brief rotates the camera along the x axis
- * multiplies the up and back vector by rot
+ * rotates the up and back vector by a quaternion about right
  * @param angle
  * @return Camera&
  */
 Camera& Camera::pitch(float angle)
 {
-    glm::mat4 pitchRot = glm::rotate(angle, glm::vec3(right_vector.x, right_vector.y, right_vector.z));
-    up_vector = pitchRot * up_vector;
-    back_vector = pitchRot * back_vector;
+    glm::quat pitchRot = glm::angleAxis(angle, glm::normalize(glm::vec3(right_vector)));
+    up_vector = rotateVec(pitchRot, up_vector);
+    back_vector = rotateVec(pitchRot, back_vector);
+    orthonormalize(back_vector, right_vector, up_vector);
     return *this;
 
 }
 
 /**
  * @brief rotates the camera along the Z axis
- * multiplies the up and right vector by rot mat
+ * rotates the up and right vector by a quaternion about back
  * @param angle
  * @return Camera&
  */
 Camera& Camera::roll(float angle)
 {
-    glm::mat4 rollRot = glm::rotate(angle, glm::vec3(back_vector.x, back_vector.y, back_vector.z));
-    up_vector = rollRot * up_vector;
-    right_vector = rollRot * right_vector;
+    glm::quat rollRot = glm::angleAxis(angle, glm::normalize(glm::vec3(back_vector)));
+    up_vector = rotateVec(rollRot, up_vector);
+    right_vector = rotateVec(rollRot, right_vector);
+    orthonormalize(back_vector, right_vector, up_vector);
     return *this;
 }
 
@@ -264,4 +271,44 @@ glm::vec4 cross(const glm::vec4& u, const glm::vec4& v)
     return glm::vec4(cross, 0);
 }
 
+/**
+ * @brief rotates a direction by a quaternion,
+ *  much cheaper than building a 4x4 rotation for two vectors
+ *
+ * @param rot
+ * @param vector
+ * @return glm::vec4
+ */
+glm::vec4 rotateVec(const glm::quat& rot, const glm::vec4& vector)
+{
+    return glm::vec4(rot * glm::vec3(vector), 0);
+}
 
+/**
+ * @brief re-orthonormalizes the camera basis (Gram-Schmidt).
+ * rounding in every rotation slowly skews and stretches the vectors,
+ * this keeps back as the reference and rebuilds the other two from it.
+ * Only runs once the basis has drifted past a small tolerance,
+ * so most rotations skip it
+ *
+ * @param Nvec
+ * @param Uvec
+ * @param Vvec
+ */
+void orthonormalize(glm::vec4& Nvec, glm::vec4& Uvec, glm::vec4& Vvec)
+{
+    const float tolerance = 1e-5f;
+    glm::vec3 n(Nvec);
+    glm::vec3 u(Uvec);
+    glm::vec3 v(Vvec);
+    float drift = fabsf(glm::dot(n, n) - 1) + fabsf(glm::dot(u, u) - 1) + fabsf(glm::dot(v, v) - 1) +
+                  fabsf(glm::dot(n, u)) + fabsf(glm::dot(n, v)) + fabsf(glm::dot(u, v));
+    if (drift < tolerance)
+        return;
+
+    n = glm::normalize(n);
+    u = glm::normalize(u - n * glm::dot(n, u));
+    Nvec = glm::vec4(n, 0);
+    Uvec = glm::vec4(u, 0);
+    Vvec = cross(Nvec, Uvec);
+}
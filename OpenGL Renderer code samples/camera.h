@@ -15,6 +15,9 @@ End Header --------------------------------------------------------*/
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Frustum.h"
+
+#include <cmath> // NAN
 #include <vector>
 
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
@@ -53,6 +56,11 @@ public:
 
     bool enabled = false;
 
+    // projection settings, change them with SetProjection so the cached matrices know
+    float Aspect = 16.0f / 9.0f;
+    float NearPlane = 0.1f;
+    float FarPlane = 100.0f;
+
     // constructor with vectors
     Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
     {
@@ -72,10 +80,63 @@ public:
         updateCameraVectors();
     }
 
-    // returns the view matrix calculated using Euler Angles and the LookAt Matrix
-    glm::mat4 GetViewMatrix()
+    // returns the view matrix calculated using Euler Angles and the LookAt Matrix.
+    // cached, only rebuilt when position or orientation changed since the last call
+    const glm::mat4& GetViewMatrix()
+    {
+        updateMatrices();
+        return view;
+    }
+
+    // cached like the view matrix, rebuilt when zoom or the projection settings change
+    const glm::mat4& GetProjectionMatrix()
+    {
+        updateMatrices();
+        return projection;
+    }
+
+    const glm::mat4& GetViewProjectionMatrix()
+    {
+        updateMatrices();
+        return viewProjection;
+    }
+
+    const glm::mat4& GetInverseViewMatrix()
+    {
+        updateMatrices();
+        return inverseView;
+    }
+
+    const glm::mat4& GetInverseProjectionMatrix()
+    {
+        updateMatrices();
+        return inverseProjection;
+    }
+
+    const glm::mat4& GetInverseViewProjectionMatrix()
+    {
+        updateMatrices();
+        return inverseViewProjection;
+    }
+
+    // sets the projection used by the matrices above, usually on window resize
+    void SetProjection(float aspect, float nearPlane, float farPlane)
+    {
+        Aspect = aspect;
+        NearPlane = nearPlane;
+        FarPlane = farPlane;
+    }
+
+    // returns the planes of everything the camera can see, for culling with Frustum::cullAABBs
+    Frustum GetFrustum()
+    {
+        return Frustum(GetViewProjectionMatrix());
+    }
+
+    Frustum GetFrustum(float aspect, float nearPlane = 0.1f, float farPlane = 100.0f)
     {
-        return glm::lookAt(Position, Position + Front, Up);
+        SetProjection(aspect, nearPlane, farPlane);
+        return GetFrustum();
     }
 
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
@@ -125,6 +186,54 @@ public:
     }
 
 private:
+    // cached matrices and the camera state they were built from
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::mat4 inverseView = glm::mat4(1.0f);
+    glm::mat4 inverseProjection = glm::mat4(1.0f);
+    glm::mat4 inverseViewProjection = glm::mat4(1.0f);
+    glm::vec3 builtPosition = glm::vec3(NAN);
+    glm::vec3 builtFront = glm::vec3(NAN);
+    glm::vec3 builtUp = glm::vec3(NAN);
+    glm::vec4 builtProjection = glm::vec4(NAN); // zoom, aspect, near and far
+
+    // the attributes are public and may be written directly, so the dirty check compares
+    // them against what the cache was built from instead of relying on setters.
+    // NAN never compares equal, so the first call always builds
+    void updateMatrices()
+    {
+        bool viewDirty = Position != builtPosition || Front != builtFront || Up != builtUp;
+        glm::vec4 projectionState(Zoom, Aspect, NearPlane, FarPlane);
+        bool projectionDirty = projectionState != builtProjection;
+
+        if (viewDirty)
+        {
+            view = glm::lookAt(Position, Position + Front, Up);
+
+            // the view is a rotation and a translation, so the inverse is the transposed rotation
+            // moved to the camera position, no general 4x4 inverse needed
+            inverseView = glm::mat4(glm::transpose(glm::mat3(view)));
+            inverseView[3] = glm::vec4(Position, 1.0f);
+            builtPosition = Position;
+            builtFront = Front;
+            builtUp = Up;
+        }
+
+        if (projectionDirty)
+        {
+            projection = glm::perspective(glm::radians(Zoom), Aspect, NearPlane, FarPlane);
+            inverseProjection = glm::inverse(projection);
+            builtProjection = projectionState;
+        }
+
+        if (viewDirty || projectionDirty)
+        {
+            viewProjection = projection * view;
+            inverseViewProjection = inverseView * inverseProjection;
+        }
+    }
+
     // calculates the front vector from the Camera's (updated) Euler Angles
     void updateCameraVectors()
     {